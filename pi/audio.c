@@ -1,20 +1,14 @@
 // ===== audio.c =====
 #include "audio.h"
-#include "ui.h"
 #include "presets.h"
+#include "drift.h"
+#include "ratedet.h"
 
 #include <pthread.h>
 #include <math.h>
 #include <stdio.h>
 #include <time.h>
 
-extern ui_state_t ui;
-extern pthread_mutex_t cfg_lock;
-
-#define ALSA_DEVICE "hw:0,0"
-#define ALSA_RATE   48000
-#define ALSA_CH     2
-#define ALSA_FORMAT SND_PCM_FORMAT_S24_LE
 
 // time helpers --------------------------------------------------------
 static inline uint64_t now_ns(void) {
@@ -29,6 +23,21 @@ static inline uint64_t now_ms(void) {
     return ((uint64_t)ts.tv_sec * 1000ULL) + ts.tv_nsec / 1000000ULL;
 }
 
+// The capture config for another rate, period and buffer scaled to keep
+// their duration
+static capture_cfg_t capture_cfg_at(const capture_cfg_t *cc, unsigned rate)
+{
+    capture_cfg_t r = *cc;
+    unsigned base = cc->rate ? cc->rate : CAPTURE_RATE_DEFAULT;
+    unsigned period = cc->period ? cc->period : CAPTURE_PERIOD_DEFAULT;
+
+    r.rate = rate;
+    r.period = (unsigned)((uint64_t)period * rate / base);
+    if (r.period > CAPTURE_MAX_FRAMES) r.period = CAPTURE_MAX_FRAMES;
+    r.buffer = (unsigned)((uint64_t)cc->buffer * rate / base);
+    return r;
+}
+
 // --------------------------------------------------------------------
 static void *audio_thread(void *arg)
 {
@@ -36,112 +45,73 @@ static void *audio_thread(void *arg)
     ringbuf_t *rb = aa->rb;
     testmode_t *tm = &aa->test;
 
+    unsigned rate = aa->capture.rate ? aa->capture.rate : CAPTURE_RATE_DEFAULT;
+    bool test = tm->test_tone || tm->test_ramp;
+    bool auto_rate = !test && !aa->capture.rate;
+
     // DSP state
-    dcblock_t dc;
-    fir_t fir;
-    postfir_t postfir;
-    nshaper_t ns;
-    dsp_init(&dc, &fir, &postfir, &ns);
-
-    snd_pcm_t *pcm = NULL;
-
-    #define ALSA_FRAMES 256
-    int32_t alsa_buf[ALSA_FRAMES * 2];
-
-    // open ALSA if not test mode
-    if (!tm->test_tone && !tm->test_ramp) {
-        snd_pcm_open(&pcm, ALSA_DEVICE, SND_PCM_STREAM_CAPTURE, 0);
-
-        snd_pcm_hw_params_t *p;
-        snd_pcm_hw_params_alloca(&p);
-        snd_pcm_hw_params_any(pcm, p);
-        snd_pcm_hw_params_set_access(pcm, p, SND_PCM_ACCESS_RW_INTERLEAVED);
-        snd_pcm_hw_params_set_format(pcm, p, ALSA_FORMAT);
-        snd_pcm_hw_params_set_channels(pcm, p, ALSA_CH);
-        snd_pcm_hw_params_set_rate(pcm, p, ALSA_RATE, 0);
-
-        snd_pcm_hw_params(pcm, p);
-        snd_pcm_prepare(pcm);
+    dsp_state_t dsp;
+    dsp_state_init(&dsp, rate);
+    dsp.fixed = aa->fixed;
+
+    // clock drift loop on the ring fill
+    drift_ctl_t drift;
+    bool drift_on = aa->drift_setpoint > 0;
+    drift_init(&drift, (float)aa->drift_setpoint, aa->cfg.target_rate);
+
+    capture_t *cap = aa->cap;
+    float in_buf[CAPTURE_MAX_FRAMES];
+    uint8_t out_buf[CAPTURE_MAX_FRAMES];
+
+    // test mode blocks are one period long too
+    int block = aa->capture.period ? (int)aa->capture.period : CAPTURE_PERIOD_DEFAULT;
+    if (block > CAPTURE_MAX_FRAMES) block = CAPTURE_MAX_FRAMES;
+
+    // open ALSA if not test mode; the device may run at another rate
+    if (!test) {
+        if (capture_open(cap, &aa->capture, aa->capture_stats) < 0)
+            return NULL;
+        if (cap->rate != rate) {
+            rate = cap->rate;
+            dsp_set_src_rate(&dsp, rate);
+        }
     }
+    ratedet_t rd;
+    ratedet_init(&rd, rate);
+    unsigned refused = 0;       // link rate the device wouldn't open at
 
     float phase = 0.0f;
-    float phase_inc = 2.f * M_PI * tm->test_freq / ALSA_RATE;
-    float ds_acc = 0.0f;
+    float phase_inc = 2.f * M_PI * tm->test_freq / rate;
+    uint8_t rv = 0;
+
+    dsp_config_t cfg = aa->cfg;
+    unsigned cfg_gen = 0;
+
+    audio_metrics_t meters = { 0 };
+    lat_tag_t tag;
+    uint32_t pushed_total = 0;  // ring stream position, for latency tags
 
     for (;;) {
 
-        // --- load live DSP config ---
-        pthread_mutex_lock(ui.cfg_lock);
-        dsp_config_t cfg = *ui.cfg;
-        pthread_mutex_unlock(ui.cfg_lock);
+        // --- pick up a new DSP config if the UI published one ---
+        cfg_fetch(aa->cfg_snap, &cfg_gen, &cfg);
 
-        uint64_t start_ns = now_ns();
+        int frames = block;
 
         // -----------------------------------------------------------------
         // TEST MODE
         // -----------------------------------------------------------------
-        if (tm->test_tone || tm->test_ramp) {
-
-            float x;
-
-            if (tm->test_ramp) {
-                static uint8_t rv = 0;
-                x = (rv++ / 127.5f) - 1.f;
-            } else {
-                x = sinf(phase) * 0.9f;
-                phase += phase_inc;
-                if (phase >= 2.f * M_PI) phase -= 2.f * M_PI;
-            }
+        if (test) {
 
-            // DC-block
-            float dc_x = dsp_dcblock(&dc, x);
-
-            // pre-FIR
-            if (cfg.filter)
-                dc_x = dsp_fir(&fir, dc_x);
-
-            // compressor
-            if (cfg.compress)
-                dc_x = dsp_compress(&ns, dc_x);
-
-            // saturator
-            if (cfg.saturate)
-                dc_x = dsp_saturate(dc_x);
-
-            // quantizer
-            float before = dc_x;
-            float q_over = dsp_quantize_oversample(
-                &ns, before, cfg.shape, cfg.dither
-            );
-            float qerr = before - q_over;
-
-            float qf = cfg.filter ? dsp_postfir(&postfir, q_over) : q_over;
-
-            // decimate 48k → 28k
-            ds_acc += cfg.target_rate;
-            if (ds_acc >= ALSA_RATE) {
-                ds_acc -= ALSA_RATE;
-
-                uint8_t q = dsp_quantize_final(&ns, qf, cfg.shape);
-                ringbuf_push(rb, q);
+            for (int i = 0; i < frames; i++) {
+                if (tm->test_ramp) {
+                    in_buf[i] = (rv++ / 127.5f) - 1.f;
+                } else {
+                    in_buf[i] = sinf(phase) * 0.9f;
+                    phase += phase_inc;
+                    if (phase >= 2.f * M_PI) phase -= 2.f * M_PI;
+                }
             }
-
-            // compute dsp load
-            float dsp_load = (float)(now_ns() - start_ns) /
-                             (1000000000.0f / ALSA_RATE);
-
-            // send metrics
-            ui_update_audio_metrics(&ui,
-                fabsf(before),
-                qerr,
-                dc_x,
-                dsp_load,
-                now_ms()
-            );
-
-            // pacing
-            struct timespec ts = {0, 20833};
-            nanosleep(&ts, NULL);
         }
 
         // -----------------------------------------------------------------
@@ -149,74 +119,99 @@ static void *audio_thread(void *arg)
         // -----------------------------------------------------------------
         else
         {
-            int frames = snd_pcm_readi(pcm, alsa_buf, ALSA_FRAMES);
-            if (frames < 0) {
-                snd_pcm_prepare(pcm);
-                continue;
-            }
-
-            for (int i = 0; i < frames; i++) {
-
-                int32_t rawL = alsa_buf[i * 2]     & 0x00FFFFFF;
-                int32_t rawR = alsa_buf[i * 2 + 1] & 0x00FFFFFF;
-
-                if (rawL & 0x800000) rawL |= 0xFF000000;
-                if (rawR & 0x800000) rawR |= 0xFF000000;
-
-                float L = rawL / 8388608.0f;
-                float R = rawR / 8388608.0f;
-
-                float x = ((L + R) * 0.5f) * cfg.gain;
-
-                // --- DSP chain ---
-                float dc_x = dsp_dcblock(&dc, x);
-
-                if (cfg.filter)
-                    dc_x = dsp_fir(&fir, dc_x);
-
-                if (cfg.compress)
-                    dc_x = dsp_compress(&ns, dc_x);
-
-                if (cfg.saturate)
-                    dc_x = dsp_saturate(dc_x);
+            // mmap: converted straight out of the DMA buffer
+            frames = capture_read(cap, in_buf, block, cfg.gain);
+            if (frames < 0)
+                break;      // can't restart the stream, error is in the UI
+            if (frames == 0)
+                continue;   // xrun/suspend recovered
+        }
 
-                float before = dc_x;
+        recorder_push_in(aa->rec, in_buf, frames, rate);
 
-                float q_over = dsp_quantize_oversample(
-                    &ns, before, cfg.shape, cfg.dither
-                );
-                float qerr = before - q_over;
+        // --- DSP chain, one block ---
+        uint64_t start_ns = now_ns();
 
-                float qf = cfg.filter ? dsp_postfir(&postfir, q_over) : q_over;
+        // the block's first sample was captured (queued + block) frames ago
+        if (aa->lat) {
+            snd_pcm_sframes_t queued = test ? 0 : capture_delay(cap);
+            tag.t_read = start_ns;
+            tag.t_capture = test ? start_ns
+                                 : start_ns - (uint64_t)(queued + frames) *
+                                   1000000000ULL / rate;
+        }
 
-                // decimation
-                ds_acc += cfg.target_rate;
-                if (ds_acc >= ALSA_RATE) {
-                    ds_acc -= ALSA_RATE;
+        dsp_block_stats_t stats;
+        int produced = dsp_process_block(&dsp, &cfg, in_buf, out_buf,
+                                         frames, &stats);
+        if (aa->lat)
+            tag.t_dsp = now_ns();
 
-                    uint8_t q = dsp_quantize_final(&ns, qf, cfg.shape);
-                    ringbuf_push(rb, q);
-                }
+        uint32_t pushed = ringbuf_push_bulk(rb, out_buf, produced);
+        ringbuf_notify(rb);
 
-                float dsp_load = (float)(now_ns() - start_ns) /
-                                 (1000000000.0f / ALSA_RATE);
-                start_ns = now_ns(); // next frame timing
-
-                ui_update_audio_metrics(&ui,
-                    fabsf(before),
-                    qerr,
-                    dc_x,
-                    dsp_load,
-                    now_ms()
-                );
+        if (aa->lat && pushed) {
+            tag.pos = pushed_total;
+            tag.t_enqueue = now_ns();
+            lat_tag_push(aa->lat, &tag);
+        }
+        pushed_total += pushed;
+
+        // measure mid-block so the block sawtooth doesn't bias the loop
+        float fill = (float)ringbuf_fill(rb) - produced * 0.5f;
+        if (drift_on)
+            dsp.drift_ppm = drift_update(&drift, fill, (float)frames / rate);
+
+        // compute dsp load against the block's real-time duration
+        float block_ns = frames * (1000000000.0f / rate);
+        float dsp_load = (float)(now_ns() - start_ns) / block_ns;
+        float os_load = (float)stats.os_ns / block_ns;
+
+        // meters, published whole once per block
+        if (metrics_take_reset(aa->metrics)) {
+            meters.peak_level = 0.0f;
+            meters.clipped = false;
+            meters.clip_count = 0;
+        }
+        metrics_update(&meters, &stats, stats.samples, dsp_load, os_load, now_ms());
+        meters.ring_fill = fill;
+        meters.drift_ppm = dsp.drift_ppm;
+        metrics_publish(aa->metrics, &meters);
+
+        // auto rate: when the link changes rate, reopen at it and rebuild
+        // the decimation; the chain's filters follow on the next block
+        if (auto_rate) {
+            unsigned r = ratedet_update(&rd, frames, now_ns());
+            if (r && r != refused) {
+                capture_cfg_t cc = capture_cfg_at(&aa->capture, r);
+                capture_close(cap);
+                if (capture_open(cap, &cc, aa->capture_stats) < 0)
+                    break;
+                atomic_fetch_add(&aa->capture_stats->rate_changes, 1);
+                // a nearby rate means the device can't do r: the link
+                // still measures r, so don't reopen for it again until
+                // the link moves somewhere else
+                refused = cap->rate != r ? r : 0;
+                rate = cap->rate;
+                block = (int)cap->period;
+                dsp_set_src_rate(&dsp, rate);
+                ratedet_init(&rd, rate);
+                continue;
             }
         }
+
+        // pacing (test mode only; ALSA paces capture)
+        if (test) {
+            struct timespec ts = {0, (long)(frames * (1000000000.0 / rate))};
+            nanosleep(&ts, NULL);
+        }
     }
 
+    capture_close(cap);
     return NULL;
 }
 
-int audio_thread_create(pthread_t *th, audio_args_t *aa)
+int audio_thread_create(pthread_t *th, audio_args_t *aa, const rt_thread_cfg_t *rt)
 {
-    return pthread_create(th, NULL, audio_thread, aa);
+    return rt_thread_create(th, rt, "audio", audio_thread, aa);
 }
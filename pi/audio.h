@@ -1,10 +1,15 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
-#include <alsa/asoundlib.h>
 #include <stdbool.h>
 #include "dsp.h"
 #include "ringbuf.h"
+#include "cfg_snapshot.h"
+#include "latency.h"
+#include "rt.h"
+#include "capture.h"
+#include "metrics.h"
+#include "recorder.h"
 
 typedef struct {
     bool test_tone;
@@ -14,10 +19,19 @@ typedef struct {
 
 typedef struct {
     ringbuf_t *rb;
-    dsp_config_t cfg;
+    dsp_config_t cfg;           // initial config (generation 0)
+    cfg_snapshot_t *cfg_snap;   // live config, published by the UI
     testmode_t test;
+    capture_cfg_t capture;      // ALSA device, rate, period/buffer
+    capture_stats_t *capture_stats;
+    capture_t *cap;             // capture state, large: not on the stack
+    metrics_snapshot_t *metrics;    // meters out to the UI
+    int drift_setpoint;         // ring fill the drift loop holds, 0 = off
+    bool fixed;                 // integer DSP path (dsp_fixed.c)
+    lat_trace_t *lat;           // latency tracing, NULL = off
+    recorder_t *rec;            // session recorder (pre-DSP input), NULL = off
 } audio_args_t;
 
-int audio_thread_create(pthread_t *th, audio_args_t *aa);
+int audio_thread_create(pthread_t *th, audio_args_t *aa, const rt_thread_cfg_t *rt);
 
 #endif
@@ -0,0 +1,344 @@
+// DSP benchmark: runs synthetic signals through every stage in dsp.c and
+// dsp_fixed.c, and every preset in presets.c on both paths. No ALSA, no
+// spidev; builds on any Linux box.
+//
+//   ./dsp_bench           human-readable table
+//   ./dsp_bench --csv     one CSV row per (stage, signal), stable columns
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dsp.h"
+#include "dsp_fixed.h"
+#include "presets.h"
+
+#define BENCH_IN_RATE  48000.0f
+#define BENCH_N        (1 << 16)   // samples per pass
+#define BENCH_PASSES   16          // best pass is reported
+#define BENCH_BLOCK    256         // block size for preset runs (ALSA period)
+
+static volatile float sink;        // keeps results alive
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+// Signals
+// --------------------------------------------------------------------
+typedef enum { SIG_SILENCE, SIG_SINE, SIG_NOISE, SIG_COUNT } signal_t;
+
+static const char *signal_name[SIG_COUNT] = { "silence", "sine", "noise" };
+
+static void make_signal(signal_t s, float *buf, int n)
+{
+    uint32_t r = 0x9E3779B9;
+
+    for (int i = 0; i < n; i++) {
+        switch (s) {
+        case SIG_SILENCE:
+            buf[i] = 0.0f;
+            break;
+        case SIG_SINE:  // full scale, 997 Hz
+            buf[i] = sinf(2.0f * (float)M_PI * 997.0f * i / BENCH_IN_RATE);
+            break;
+        default:        // uniform white noise, full scale
+            r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+            buf[i] = (float)r / 2147483648.0f - 1.0f;
+            break;
+        }
+    }
+}
+
+// --------------------------------------------------------------------
+// Stages
+// --------------------------------------------------------------------
+static dsp_state_t st;
+static uint8_t out8[BENCH_N];
+
+static void run_dcblock(const float *in, int n) {
+    float acc = 0.0f;
+    for (int i = 0; i < n; i++) acc += dsp_dcblock(&st.dc, in[i]);
+    sink = acc;
+}
+
+static void run_fir(const float *in, int n) {
+    float acc = 0.0f;
+    for (int i = 0; i < n; i++) acc += dsp_fir(&st.fir, in[i]);
+    sink = acc;
+}
+
+// the pre-FIR designed for another target (the warm-up run designs it)
+static void run_fir_rate(const float *in, int n, float rate) {
+    dsp_filters_set(&st, BENCH_IN_RATE, rate);
+    run_fir(in, n);
+}
+
+static void run_fir_16k(const float *in, int n) { run_fir_rate(in, n, 16574.0f); }
+static void run_fir_44k(const float *in, int n) { run_fir_rate(in, n, 44100.0f); }
+
+// block stages work in place: time them on a copy
+static float work[BENCH_N];
+
+static void run_compress(const float *in, int n) {
+    memcpy(work, in, n * sizeof(float));
+    dsp_compress_block(&st.ns, &st.dyn, work, n);
+    sink = work[n - 1];
+}
+
+static void run_saturate(const float *in, int n) {
+    memcpy(work, in, n * sizeof(float));
+    dsp_saturate_block(work, n);
+    sink = work[n - 1];
+}
+
+// halfband round trip, no stage in between
+static float hi[DSP_OVERSAMPLE_MAX * BENCH_N];
+
+static void run_oversample(const float *in, int n, int factor) {
+    dsp_oversampler_reset(&st.os, factor);
+    dsp_oversample_up(&st.os, in, hi, n);
+    dsp_oversample_down(&st.os, hi, work, n);
+    sink = work[n - 1];
+}
+
+static void run_oversample2(const float *in, int n) { run_oversample(in, n, 2); }
+static void run_oversample4(const float *in, int n) { run_oversample(in, n, 4); }
+
+// source decimation, per source sample: 96k -> 48k, 192k -> 48k
+static void run_decimate(const float *in, int n, int factor) {
+    dsp_oversampler_reset(&st.dec, factor);
+    dsp_oversample_down(&st.dec, in, work, n / factor);
+    sink = work[n / factor - 1];
+}
+
+static void run_decimate2(const float *in, int n) { run_decimate(in, n, 2); }
+static void run_decimate4(const float *in, int n) { run_decimate(in, n, 4); }
+
+static void run_qover_plain(const float *in, int n) {
+    float acc = 0.0f;
+    for (int i = 0; i < n; i++)
+        acc += dsp_quantize_oversample(&st.ns, in[i], false, 0.0f);
+    sink = acc;
+}
+
+// dither made a block ahead, as in the chain
+static void run_dither(const float *in, int n, int mode) {
+    st.dith.mode = mode;
+    dither_block(&st.dith, work, n);
+    sink = work[n - 1];
+}
+
+static void run_dither_hp(const float *in, int n)     { run_dither(in, n, DITHER_HP); }
+static void run_dither_shaped(const float *in, int n) { run_dither(in, n, DITHER_SHAPED); }
+
+static void run_qover_shape_dither(const float *in, int n) {
+    float acc = 0.0f;
+    dither_block(&st.dith, work, n);
+    for (int i = 0; i < n; i++)
+        acc += dsp_quantize_oversample(&st.ns, in[i], true, work[i]);
+    sink = acc;
+}
+
+static void run_resample_filter(const float *in, int n) {
+    float acc = 0.0f, y;
+    for (int i = 0; i < n; i++)
+        if (dsp_resample(&st.rs, in[i], true, &y)) acc += y;
+    sink = acc;
+}
+
+static void run_resample_linear(const float *in, int n) {
+    float acc = 0.0f, y;
+    for (int i = 0; i < n; i++)
+        if (dsp_resample(&st.rs, in[i], false, &y)) acc += y;
+    sink = acc;
+}
+
+static void run_qfinal_shape(const float *in, int n) {
+    unsigned acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_quantize_final(&st.ns, in[i], true);
+    sink = (float)acc;
+}
+
+// integer stages read in_fx, the signal converted to Q27 before timing
+static int32_t in_fx[BENCH_N];
+
+static void run_fx_dcblock(const float *in, int n) {
+    int32_t acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_fx_dcblock(&st.fx, in_fx[i]);
+    sink = (float)acc;
+}
+
+static void run_fx_fir(const float *in, int n) {
+    int32_t acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_fx_fir(&st.fx, in_fx[i]);
+    sink = (float)acc;
+}
+
+static void run_fx_compress(const float *in, int n) {
+    int32_t acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_fx_compress(&st.fx, in_fx[i]);
+    sink = (float)acc;
+}
+
+static void run_fx_saturate(const float *in, int n) {
+    int32_t acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_fx_saturate(in_fx[i]);
+    sink = (float)acc;
+}
+
+static void run_fx_qover_shape_dither(const float *in, int n) {
+    int32_t acc = 0;
+    dither_block(&st.dith, work, n);
+    for (int i = 0; i < n; i++)
+        acc += dsp_fx_quantize_oversample(&st.fx, in_fx[i], true,
+                                          dsp_fx_from_float(work[i]));
+    sink = (float)acc;
+}
+
+static void run_fx_resample_filter(const float *in, int n) {
+    int64_t step = (int64_t)(st.rs.step * 4294967296.0);
+    int32_t acc = 0, y;
+    for (int i = 0; i < n; i++)
+        if (dsp_fx_resample(&st.fx, step, in_fx[i], true, &y)) acc += y;
+    sink = (float)acc;
+}
+
+static void run_fx_qfinal_shape(const float *in, int n) {
+    unsigned acc = 0;
+    for (int i = 0; i < n; i++) acc += dsp_fx_quantize_final(&st.fx, in_fx[i], true);
+    sink = (float)acc;
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(const float *in, int n);
+} stage_t;
+
+static const stage_t STAGES[] = {
+    { "dcblock",             run_dcblock },
+    { "fir",                 run_fir },
+    { "fir 16.6k",           run_fir_16k },
+    { "fir 44.1k",           run_fir_44k },
+    { "decimate 96k",        run_decimate2 },
+    { "decimate 192k",       run_decimate4 },
+    { "compress",            run_compress },
+    { "saturate",            run_saturate },
+    { "oversample 2x",       run_oversample2 },
+    { "oversample 4x",       run_oversample4 },
+    { "dither hp",           run_dither_hp },
+    { "dither shaped",       run_dither_shaped },
+    { "qover",               run_qover_plain },
+    { "qover+shape+dither",  run_qover_shape_dither },
+    { "resample+filter",     run_resample_filter },
+    { "resample+linear",     run_resample_linear },
+    { "qfinal+shape",        run_qfinal_shape },
+    { "fx:dcblock",          run_fx_dcblock },
+    { "fx:fir",              run_fx_fir },
+    { "fx:compress",         run_fx_compress },
+    { "fx:saturate",         run_fx_saturate },
+    { "fx:qover+shape+dither", run_fx_qover_shape_dither },
+    { "fx:resample+filter",  run_fx_resample_filter },
+    { "fx:qfinal+shape",     run_fx_qfinal_shape },
+};
+
+#define STAGE_COUNT (int)(sizeof(STAGES) / sizeof(STAGES[0]))
+
+// --------------------------------------------------------------------
+// Measurement
+// --------------------------------------------------------------------
+static dsp_config_t preset_cfg;
+static bool preset_fixed;
+
+static void run_preset(const float *in, int n) {
+    int produced = 0;
+    for (int i = 0; i < n; i += BENCH_BLOCK)
+        produced += dsp_process_block(&st, &preset_cfg, in + i, out8,
+                                      BENCH_BLOCK, NULL);
+    sink = (float)produced;
+}
+
+// best ns/input sample over BENCH_PASSES passes
+static double measure(void (*run)(const float *, int), const float *in)
+{
+    double best = 1e30;
+
+    dsp_state_init(&st, BENCH_IN_RATE);
+    dsp_filters_set(&st, BENCH_IN_RATE, 28149.96f);
+    dsp_resampler_set_rate(&st.rs, BENCH_IN_RATE, 28149.96f);
+    st.fixed = preset_fixed;
+    for (int i = 0; i < BENCH_N; i++)
+        in_fx[i] = dsp_fx_from_float(in[i]);
+    run(in, BENCH_N);   // warm-up
+
+    for (int p = 0; p < BENCH_PASSES; p++) {
+        uint64_t t0 = now_ns();
+        run(in, BENCH_N);
+        double ns = (double)(now_ns() - t0) / BENCH_N;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+static bool csv;
+
+static void report(const char *kind, const char *name, signal_t s, double ns)
+{
+    double rate = 1e9 / ns;
+    double headroom = rate / BENCH_IN_RATE;   // x realtime at 48 kHz
+
+    if (csv)
+        printf("%s,%s,%s,%.3f,%.0f,%.2f\n",
+               kind, name, signal_name[s], ns, rate, headroom);
+    else
+        printf("  %-22s %-8s %9.2f ns/sample %12.0f samples/s %9.1fx realtime\n",
+               name, signal_name[s], ns, rate, headroom);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--csv")) {
+            csv = true;
+        } else {
+            fprintf(stderr, "usage: dsp_bench [--csv]\n");
+            return 1;
+        }
+    }
+
+    static float in[SIG_COUNT][BENCH_N];
+    for (int s = 0; s < SIG_COUNT; s++)
+        make_signal(s, in[s], BENCH_N);
+
+    if (csv)
+        printf("kind,name,signal,ns_per_sample,samples_per_s,realtime_x\n");
+    else
+        printf("Stages (per 48 kHz input sample):\n");
+
+    for (int k = 0; k < STAGE_COUNT; k++)
+        for (int s = 0; s < SIG_COUNT; s++)
+            report("stage", STAGES[k].name, s, measure(STAGES[k].run, in[s]));
+
+    if (!csv)
+        printf("\nPresets (full chain, %d-frame blocks):\n", BENCH_BLOCK);
+
+    for (int fx = 0; fx < 2; fx++) {
+        if (!csv && fx)
+            printf("\nPresets, fixed-point path:\n");
+        preset_fixed = fx;
+
+        for (int p = 0; p < preset_count(); p++) {
+            preset_cfg = (dsp_config_t){ .gain = 1.0f, .target_rate = 28149.96f };
+            preset_apply(p, &preset_cfg);
+            for (int s = 0; s < SIG_COUNT; s++)
+                report(fx ? "preset-fixed" : "preset", preset_get(p)->name, s,
+                       measure(run_preset, in[s]));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CAPTURE_CH     2                        // asked for; mono accepted
+#define CAPTURE_WAIT_MS 1000
+
+// in order of preference; all are read as 24 bits
+static const snd_pcm_format_t capture_formats[] = {
+    SND_PCM_FORMAT_S24_LE,      // 24 bits in 32-bit words
+    SND_PCM_FORMAT_S32_LE,
+    SND_PCM_FORMAT_S16_LE,
+};
+
+void capture_cfg_latency(capture_cfg_t *cc, float ms, unsigned periods)
+{
+    if (periods < 2) periods = 2;
+    unsigned rate = cc->rate ? cc->rate : CAPTURE_RATE_DEFAULT;
+    unsigned buffer = (unsigned)(rate * ms / 1000.0f + 0.5f);
+    unsigned period = buffer / periods;
+    if (period < 16) period = 16;
+    if (period > CAPTURE_MAX_FRAMES) period = CAPTURE_MAX_FRAMES;
+
+    cc->period = period;
+    cc->buffer = period * periods;
+}
+
+// --------------------------------------------------------------------
+// Setup
+// --------------------------------------------------------------------
+#define CHECK(call) do {                                            \
+        int err_ = (call);                                          \
+        if (err_ < 0) {                                             \
+            fprintf(stderr, "capture: %s: %s\n", #call,             \
+                    snd_strerror(err_));                            \
+            return err_;                                            \
+        }                                                           \
+    } while (0)
+
+static int set_hw_params(capture_t *c, const capture_cfg_t *cc, bool mmap)
+{
+    snd_pcm_hw_params_t *p;
+    snd_pcm_hw_params_alloca(&p);
+
+    snd_pcm_uframes_t period = cc->period ? cc->period : CAPTURE_PERIOD_DEFAULT;
+    snd_pcm_uframes_t buffer = cc->buffer ? cc->buffer
+                                          : period * CAPTURE_PERIODS_DEFAULT;
+    if (period > CAPTURE_MAX_FRAMES) period = CAPTURE_MAX_FRAMES;
+
+    CHECK(snd_pcm_hw_params_any(c->pcm, p));
+    CHECK(snd_pcm_hw_params_set_access(c->pcm, p,
+              mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED));
+
+    // first format the device takes
+    unsigned f = 0;
+    while (f < sizeof(capture_formats) / sizeof(capture_formats[0]) &&
+           snd_pcm_hw_params_test_format(c->pcm, p, capture_formats[f]) < 0)
+        f++;
+    if (f == sizeof(capture_formats) / sizeof(capture_formats[0])) {
+        fprintf(stderr, "capture: no S24/S32/S16 little-endian format\n");
+        return -EINVAL;
+    }
+    c->format = capture_formats[f];
+    CHECK(snd_pcm_hw_params_set_format(c->pcm, p, c->format));
+
+    c->channels = CAPTURE_CH;
+    CHECK(snd_pcm_hw_params_set_channels_near(c->pcm, p, &c->channels));
+    if (c->channels > CAPTURE_CH) {
+        fprintf(stderr, "capture: %u channels, want 1 or 2\n", c->channels);
+        return -EINVAL;
+    }
+
+    c->rate = cc->rate ? cc->rate : CAPTURE_RATE_DEFAULT;
+    CHECK(snd_pcm_hw_params_set_rate_near(c->pcm, p, &c->rate, 0));
+    CHECK(snd_pcm_hw_params_set_period_size_near(c->pcm, p, &period, NULL));
+    CHECK(snd_pcm_hw_params_set_buffer_size_near(c->pcm, p, &buffer));
+    CHECK(snd_pcm_hw_params(c->pcm, p));
+
+    CHECK(snd_pcm_hw_params_get_period_size(p, &c->period, NULL));
+    CHECK(snd_pcm_hw_params_get_buffer_size(p, &c->buffer));
+    if (c->period > CAPTURE_MAX_FRAMES) {
+        fprintf(stderr, "capture: period %lu > %d frames\n",
+                (unsigned long)c->period, CAPTURE_MAX_FRAMES);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int set_sw_params(capture_t *c)
+{
+    snd_pcm_sw_params_t *s;
+    snd_pcm_sw_params_alloca(&s);
+
+    CHECK(snd_pcm_sw_params_current(c->pcm, s));
+    CHECK(snd_pcm_sw_params_set_avail_min(c->pcm, s, c->period));
+    CHECK(snd_pcm_sw_params(c->pcm, s));
+    return 0;
+}
+
+int capture_open(capture_t *c, const capture_cfg_t *cc, capture_stats_t *st)
+{
+    memset(c, 0, sizeof(*c));
+    c->stats = st;
+    c->channel = cc->channel;
+
+    const char *dev = cc->device ? cc->device : CAPTURE_DEVICE_DEFAULT;
+    int err = snd_pcm_open(&c->pcm, dev, SND_PCM_STREAM_CAPTURE, 0);
+    if (err < 0) {
+        fprintf(stderr, "capture: open %s: %s\n", dev, snd_strerror(err));
+        atomic_store(&st->error, err);
+        return err;
+    }
+
+    // mmap unless asked not to or the device refuses it
+    c->mmap = !cc->rw;
+    err = set_hw_params(c, cc, c->mmap);
+    if (err < 0 && c->mmap) {
+        fprintf(stderr, "capture: no mmap access, falling back to readi\n");
+        c->mmap = false;
+        err = set_hw_params(c, cc, false);
+    }
+    if (err >= 0) err = set_sw_params(c);
+    if (err >= 0) err = snd_pcm_prepare(c->pcm);
+    if (err >= 0 && c->mmap) err = snd_pcm_start(c->pcm);
+
+    if (err < 0) {
+        atomic_store(&st->error, err);
+        snd_pcm_close(c->pcm);
+        c->pcm = NULL;
+        return err;
+    }
+
+    if (cc->rate && c->rate != cc->rate)
+        fprintf(stderr, "capture: %u Hz asked, device runs at %u\n", cc->rate, c->rate);
+
+    atomic_store(&st->period, (unsigned)c->period);
+    atomic_store(&st->buffer, (unsigned)c->buffer);
+    atomic_store(&st->mmap, c->mmap);
+    atomic_store(&st->rate, c->rate);
+    atomic_store(&st->format, c->format);
+    atomic_store(&st->channels, c->channels);
+    atomic_store(&st->error, 0);
+    return 0;
+}
+
+void capture_close(capture_t *c)
+{
+    if (c->pcm) snd_pcm_close(c->pcm);
+    c->pcm = NULL;
+}
+
+snd_pcm_sframes_t capture_delay(capture_t *c)
+{
+    snd_pcm_sframes_t d = 0;
+    if (snd_pcm_delay(c->pcm, &d) < 0) d = 0;
+    return d;
+}
+
+// --------------------------------------------------------------------
+// Recovery: count what happened, restart the stream
+// --------------------------------------------------------------------
+static int recover(capture_t *c, int err)
+{
+    capture_stats_t *st = c->stats;
+
+    if (err == -EPIPE) {
+        atomic_fetch_add_explicit(&st->xruns, 1, memory_order_relaxed);
+        err = snd_pcm_prepare(c->pcm);
+    } else if (err == -ESTRPIPE) {
+        atomic_fetch_add_explicit(&st->suspends, 1, memory_order_relaxed);
+        while ((err = snd_pcm_resume(c->pcm)) == -EAGAIN)
+            usleep(10000);
+        if (err < 0)
+            err = snd_pcm_prepare(c->pcm);
+    }
+    if (err >= 0 && c->mmap)
+        err = snd_pcm_start(c->pcm);
+
+    if (err < 0) {
+        fprintf(stderr, "capture: recovery failed: %s\n", snd_strerror(err));
+        atomic_store(&st->error, err);
+        return err;
+    }
+    atomic_fetch_add_explicit(&st->recoveries, 1, memory_order_relaxed);
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// Conversion to 24 bits: l and r point at a channel's first sample, step
+// is bytes per frame
+// --------------------------------------------------------------------
+static inline void downmix(const capture_t *c, float *out, const uint8_t *l,
+                           const uint8_t *r, int step, int n, float gain)
+{
+    const float scale = gain * (0.5f / 8388608.0f);
+
+    switch (c->format) {
+    case SND_PCM_FORMAT_S32_LE:
+        for (int i = 0; i < n; i++) {
+            int32_t L = *(const int32_t *)(l + i * step) >> 8;
+            int32_t R = *(const int32_t *)(r + i * step) >> 8;
+            out[i] = (float)(L + R) * scale;
+        }
+        break;
+    case SND_PCM_FORMAT_S16_LE:
+        for (int i = 0; i < n; i++) {
+            int32_t L = *(const int16_t *)(l + i * step) * 256;
+            int32_t R = *(const int16_t *)(r + i * step) * 256;
+            out[i] = (float)(L + R) * scale;
+        }
+        break;
+    default:
+        for (int i = 0; i < n; i++) {
+            // sign-extend the low 24 bits
+            int32_t L = (int32_t)(*(const uint32_t *)(l + i * step) << 8) >> 8;
+            int32_t R = (int32_t)(*(const uint32_t *)(r + i * step) << 8) >> 8;
+            out[i] = (float)(L + R) * scale;
+        }
+        break;
+    }
+}
+
+// one channel is "mixed" with itself: (L+L)/2 = L, bit for bit; so is
+// a mono device's only one
+static inline void pick_channel(const capture_t *c, const uint8_t **l, const uint8_t **r)
+{
+    if (c->channels == 1 || c->channel == 0) *r = *l;
+    else if (c->channel == 1) *l = *r;
+}
+
+static int read_rw(capture_t *c, float *out, int max, float gain)
+{
+    snd_pcm_sframes_t n = snd_pcm_readi(c->pcm, c->rw_buf, max);
+    if (n < 0)
+        return recover(c, (int)n);
+
+    int bytes = snd_pcm_format_physical_width(c->format) / 8;
+    const uint8_t *l = (const uint8_t *)c->rw_buf, *r = l + bytes;
+    pick_channel(c, &l, &r);
+    downmix(c, out, l, r, bytes * (int)c->channels, (int)n, gain);
+    return (int)n;
+}
+
+static int read_mmap(capture_t *c, float *out, int max, float gain)
+{
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(c->pcm);
+    if (avail < 0)
+        return recover(c, (int)avail);
+
+    if (avail < (snd_pcm_sframes_t)c->period) {
+        int w = snd_pcm_wait(c->pcm, CAPTURE_WAIT_MS);
+        if (w < 0)
+            return recover(c, w);
+        avail = snd_pcm_avail_update(c->pcm);
+        if (avail < 0)
+            return recover(c, (int)avail);
+        if (avail == 0)
+            return 0;
+    }
+
+    // one contiguous run straight out of the DMA buffer
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = avail < max ? (snd_pcm_uframes_t)avail
+                                           : (snd_pcm_uframes_t)max;
+    int err = snd_pcm_mmap_begin(c->pcm, &areas, &offset, &frames);
+    if (err < 0)
+        return recover(c, err);
+
+    const snd_pcm_channel_area_t *ar = &areas[c->channels > 1];
+    const uint8_t *l = (const uint8_t *)areas[0].addr +
+                       (areas[0].first + offset * areas[0].step) / 8;
+    const uint8_t *r = (const uint8_t *)ar->addr + (ar->first + offset * ar->step) / 8;
+    pick_channel(c, &l, &r);
+    downmix(c, out, l, r, areas[0].step / 8, (int)frames, gain);
+
+    snd_pcm_sframes_t done = snd_pcm_mmap_commit(c->pcm, offset, frames);
+    if (done < 0 || (snd_pcm_uframes_t)done != frames)
+        return recover(c, done < 0 ? (int)done : -EPIPE);
+
+    return (int)frames;
+}
+
+int capture_read(capture_t *c, float *out, int max, float gain)
+{
+    if (max > CAPTURE_MAX_FRAMES) max = CAPTURE_MAX_FRAMES;
+    return c->mmap ? read_mmap(c, out, max, gain) : read_rw(c, out, max, gain);
+}
@@ -0,0 +1,77 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <alsa/asoundlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// ALSA capture for the audio thread. The mmap path converts straight out
+// of the DMA buffer into the DSP's float block; the RW path (readi) is
+// kept for devices without mmap support. Format (S24 in 32 bits, S32 or
+// S16), channel count (stereo or mono) and rate are negotiated with the
+// device; rate 0 (auto) opens near the default and lets the audio thread
+// follow the link (ratedet.h).
+
+#define CAPTURE_DEVICE_DEFAULT  "hw:0,0"
+#define CAPTURE_RATE_DEFAULT    48000
+#define CAPTURE_PERIOD_DEFAULT  256     // frames, = DSP block size
+#define CAPTURE_PERIODS_DEFAULT 4
+#define CAPTURE_MAX_FRAMES      4096    // largest block the audio thread takes
+#define CAPTURE_MIX             -1      // channel: (L+R)/2
+
+typedef struct {
+    const char *device;
+    unsigned rate;              // Hz, 0 = auto
+    unsigned period;            // frames per period (requested)
+    unsigned buffer;            // frames in the ring, 0 = periods * period
+    bool rw;                    // readi instead of mmap
+    int channel;                // CAPTURE_MIX, 0 = left, 1 = right
+} capture_cfg_t;
+
+// Written by the audio thread, read by the UI
+typedef struct {
+    atomic_uint period;         // negotiated sizes
+    atomic_uint buffer;
+    atomic_bool mmap;
+    atomic_ulong xruns;         // overruns (-EPIPE)
+    atomic_ulong suspends;      // -ESTRPIPE
+    atomic_ulong recoveries;    // successful restarts after either
+    atomic_int  error;          // last fatal error (negative errno), 0 = ok
+    atomic_uint rate;           // negotiated rate, Hz
+    atomic_int  format;         // snd_pcm_format_t
+    atomic_uint channels;
+    atomic_ulong rate_changes;  // reopened for a new link rate
+} capture_stats_t;
+
+typedef struct {
+    snd_pcm_t *pcm;
+    snd_pcm_uframes_t period;
+    snd_pcm_uframes_t buffer;
+    unsigned rate;
+    snd_pcm_format_t format;
+    unsigned channels;
+    bool mmap;
+    int channel;
+    int32_t rw_buf[CAPTURE_MAX_FRAMES * 2];     // RW path only, 2 ch max
+    capture_stats_t *stats;
+} capture_t;
+
+// Derive period/buffer from a latency target: the buffer holds ms worth
+// of frames in `periods` periods (at the default rate when rate is auto).
+void capture_cfg_latency(capture_cfg_t *cc, float ms, unsigned periods);
+
+// Open and configure; every hw/sw params step is checked. Returns 0 or a
+// negative ALSA error, also stored in stats->error. Prints the failing step.
+int capture_open(capture_t *c, const capture_cfg_t *cc, capture_stats_t *st);
+
+// Up to max frames of (L+R)/2 * gain (or the one channel) into out. Blocks until a period is
+// ready. Returns frames, 0 after an xrun/suspend was recovered (call
+// again), or a negative error if the stream can't be restarted.
+int capture_read(capture_t *c, float *out, int max, float gain);
+
+// Frames captured but not yet read
+snd_pcm_sframes_t capture_delay(capture_t *c);
+
+void capture_close(capture_t *c);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CFG_SNAPSHOT_H
+#define CFG_SNAPSHOT_H
+
+#include <string.h>
+#include "dsp.h"
+#include "seqlock.h"
+
+// DSP config published by the UI thread, read lock-free by the audio
+// thread. Only one thread may publish.
+typedef struct {
+    seqlock_t lock;
+    dsp_config_t cfg;
+} cfg_snapshot_t;
+
+static inline void cfg_snapshot_init(cfg_snapshot_t *s, const dsp_config_t *c)
+{
+    seqlock_init(&s->lock);
+    s->cfg = *c;
+}
+
+static inline void cfg_publish(cfg_snapshot_t *s, const dsp_config_t *c)
+{
+    seqlock_write_begin(&s->lock);
+    memcpy(&s->cfg, c, sizeof(*c));
+    seqlock_write_end(&s->lock);
+}
+
+// Non-blocking. If a config newer than *gen is available and could be
+// copied consistently, stores it in *out, updates *gen and returns true.
+// Otherwise *out is left alone; callers just keep their current config
+// and try again on the next block.
+static inline bool cfg_fetch(const cfg_snapshot_t *s, unsigned *gen,
+                             dsp_config_t *out)
+{
+    unsigned seq;
+    if (!seqlock_try_read_begin(&s->lock, &seq))
+        return false;
+    if (seqlock_generation(seq) == *gen)
+        return false;
+
+    dsp_config_t tmp;
+    memcpy(&tmp, &s->cfg, sizeof(tmp));
+
+    if (!seqlock_try_read_end(&s->lock, seq))
+        return false;
+
+    *out = tmp;
+    *gen = seqlock_generation(seq);
+    return true;
+}
+
+#endif
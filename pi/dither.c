@@ -0,0 +1,181 @@
+#include "dither.h"
+#include <string.h>
+
+#if defined(DSP_NO_SIMD)
+#define DITHER_SIMD_NONE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DITHER_SIMD_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DITHER_SIMD_SSE2
+#else
+#define DITHER_SIMD_NONE
+#endif
+
+#define DITHER_CHUNK 256    // white noise made per pass
+
+static const char *const mode_names[DITHER_MODES] = { "hp", "flat", "shaped" };
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void dither_init(dither_t *d, uint32_t seed)
+{
+    uint64_t x = seed;
+    for (int k = 0; k < DITHER_LANES; k++)
+        for (int w = 0; w < 4; w += 2) {
+            uint64_t r = splitmix64(&x);
+            d->s[w][k] = (uint32_t)r;
+            d->s[w + 1][k] = (uint32_t)(r >> 32);
+        }
+    d->spare_pos = DITHER_LANES;
+    d->w1 = d->w2 = 0.0f;
+    d->seed = seed;
+}
+
+// n white TPDF samples, n a multiple of DITHER_LANES: lane k of two
+// consecutive steps, summed. The scalar fallback gives the same bits.
+static void white_block(dither_t *d, float *w, int n)
+{
+#if defined(DITHER_SIMD_SSE2)
+    __m128i s0 = _mm_loadu_si128((const __m128i *)d->s[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i *)d->s[1]);
+    __m128i s2 = _mm_loadu_si128((const __m128i *)d->s[2]);
+    __m128i s3 = _mm_loadu_si128((const __m128i *)d->s[3]);
+    const __m128i bias = _mm_set1_epi32(1 << 23);
+    const __m128 scale = _mm_set1_ps(1.0f / (1 << 24));
+
+    for (int i = 0; i < n; i += DITHER_LANES) {
+        __m128 u[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i r = _mm_add_epi32(s0, s3);
+            __m128i t = _mm_slli_epi32(s1, 9);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+            r = _mm_sub_epi32(_mm_srli_epi32(r, 8), bias);
+            u[h] = _mm_mul_ps(_mm_cvtepi32_ps(r), scale);
+        }
+        _mm_storeu_ps(w + i, _mm_add_ps(u[0], u[1]));
+    }
+
+    _mm_storeu_si128((__m128i *)d->s[0], s0);
+    _mm_storeu_si128((__m128i *)d->s[1], s1);
+    _mm_storeu_si128((__m128i *)d->s[2], s2);
+    _mm_storeu_si128((__m128i *)d->s[3], s3);
+#elif defined(DITHER_SIMD_NEON)
+    uint32x4_t s0 = vld1q_u32(d->s[0]), s1 = vld1q_u32(d->s[1]);
+    uint32x4_t s2 = vld1q_u32(d->s[2]), s3 = vld1q_u32(d->s[3]);
+    const int32x4_t bias = vdupq_n_s32(1 << 23);
+    const float32x4_t scale = vdupq_n_f32(1.0f / (1 << 24));
+
+    for (int i = 0; i < n; i += DITHER_LANES) {
+        float32x4_t u[2];
+        for (int h = 0; h < 2; h++) {
+            uint32x4_t r = vaddq_u32(s0, s3);
+            uint32x4_t t = vshlq_n_u32(s1, 9);
+            s2 = veorq_u32(s2, s0);
+            s3 = veorq_u32(s3, s1);
+            s1 = veorq_u32(s1, s2);
+            s0 = veorq_u32(s0, s3);
+            s2 = veorq_u32(s2, t);
+            s3 = vsriq_n_u32(vshlq_n_u32(s3, 11), s3, 21);
+            int32x4_t v = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(r, 8)), bias);
+            u[h] = vmulq_f32(vcvtq_f32_s32(v), scale);
+        }
+        vst1q_f32(w + i, vaddq_f32(u[0], u[1]));
+    }
+
+    vst1q_u32(d->s[0], s0);
+    vst1q_u32(d->s[1], s1);
+    vst1q_u32(d->s[2], s2);
+    vst1q_u32(d->s[3], s3);
+#else
+    for (int i = 0; i < n; i += DITHER_LANES)
+        for (int k = 0; k < DITHER_LANES; k++) {
+            float u[2];
+            for (int h = 0; h < 2; h++) {
+                uint32_t *s0 = &d->s[0][k], *s1 = &d->s[1][k];
+                uint32_t *s2 = &d->s[2][k], *s3 = &d->s[3][k];
+                uint32_t r = *s0 + *s3;
+                uint32_t t = *s1 << 9;
+                *s2 ^= *s0;
+                *s3 ^= *s1;
+                *s1 ^= *s2;
+                *s0 ^= *s3;
+                *s2 ^= t;
+                *s3 = (*s3 << 11) | (*s3 >> 21);
+                u[h] = (float)((int32_t)(r >> 8) - (1 << 23)) * (1.0f / (1 << 24));
+            }
+            w[i + k] = u[0] + u[1];
+        }
+#endif
+}
+
+void dither_block(dither_t *d, float *out, int n)
+{
+    for (int base = 0; base < n; base += DITHER_CHUNK) {
+        int m = n - base < DITHER_CHUNK ? n - base : DITHER_CHUNK;
+        float *o = out + base;
+
+        // w[-2], w[-1] are the previous chunk's last two samples
+        float buf[2 + DITHER_CHUNK];
+        float *w = buf + 2;
+        buf[0] = d->w2;
+        buf[1] = d->w1;
+
+        // whole groups straight in; the group that covers an odd tail is
+        // kept in spare[] and used up first next time
+        int k = 0;
+        while (k < m && d->spare_pos < DITHER_LANES)
+            w[k++] = d->spare[d->spare_pos++];
+        int whole = (m - k) & ~(DITHER_LANES - 1);
+        white_block(d, w + k, whole);
+        k += whole;
+        if (k < m) {
+            white_block(d, d->spare, DITHER_LANES);
+            d->spare_pos = 0;
+            while (k < m)
+                w[k++] = d->spare[d->spare_pos++];
+        }
+
+        switch (d->mode) {
+        case DITHER_FLAT:
+            memcpy(o, w, m * sizeof(float));
+            break;
+        case DITHER_SHAPED:
+            for (int i = 0; i < m; i++)
+                o[i] = w[i] - w[i - 1] + 0.25f * w[i - 2];
+            break;
+        default:
+            for (int i = 0; i < m; i++)
+                o[i] = w[i] - 0.5f * w[i - 1];
+            break;
+        }
+
+        d->w2 = w[m - 2];
+        d->w1 = w[m - 1];
+    }
+}
+
+int dither_mode_parse(const char *s)
+{
+    for (int m = 0; m < DITHER_MODES; m++)
+        if (!strcmp(s, mode_names[m]))
+            return m;
+    return -1;
+}
+
+const char *dither_mode_name(int mode)
+{
+    return mode >= 0 && mode < DITHER_MODES ? mode_names[mode] : "?";
+}
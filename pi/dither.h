@@ -0,0 +1,52 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// TPDF dither for the oversample quantizer, one generator per pipeline.
+//
+// DITHER_LANES independent xoshiro128+ streams advance side by side, each
+// state word stored across the lanes so one update is a vector op; a pair
+// of steps gives one TPDF sample per lane (sum of two uniforms, top 24
+// bits each).
+// A block of noise is made before the quantizer loop needs it, then
+// coloured:
+//
+//   DITHER_HP      w[n] - 0.5 w[n-1]            -6 dB at DC, +3.5 at Nyquist
+//   DITHER_FLAT    w[n]                         white
+//   DITHER_SHAPED  w[n] - w[n-1] + 0.25 w[n-2]  HP twice, -12 / +7 dB
+//
+// Output is in TPDF units (+-1 before colouring); the quantizer scales it.
+// The sequence depends only on the seed and the total count, not on how
+// it is split into blocks, so renders are reproducible.
+#define DITHER_LANES        4
+#define DITHER_SEED_DEFAULT 0x12345678u
+
+typedef enum {
+    DITHER_HP,              // 0 = default
+    DITHER_FLAT,
+    DITHER_SHAPED,
+    DITHER_MODES
+} dither_mode_t;
+
+typedef struct {
+    uint32_t s[4][DITHER_LANES];    // xoshiro128+ words, one column per lane
+    float spare[DITHER_LANES];  // last group made, for a block's odd tail
+    int spare_pos;          // first unused in spare[], DITHER_LANES = none
+    float w1, w2;           // last two white TPDF samples (colouring)
+    int mode;               // dither_mode_t, set per block by the DSP
+    uint32_t seed;          // what the state was seeded from
+} dither_t;
+
+// Seed every lane from seed (splitmix64) and clear the filter history
+void dither_init(dither_t *d, uint32_t seed);
+
+// n samples of d->mode noise into out
+void dither_block(dither_t *d, float *out, int n);
+
+// "hp", "flat", "shaped" -> DITHER_*, -1 if unknown; and back
+int dither_mode_parse(const char *s);
+const char *dither_mode_name(int mode);
+
+#endif
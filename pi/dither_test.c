@@ -0,0 +1,92 @@
+// Dither generator: the sequence depends only on the seed (not on how it
+// is split into blocks, so renders are reproducible), seeds differ, and
+// each mode has the spectrum it claims: TPDF range and zero mean for
+// flat, and the low/high band energy ratio of the colouring filter.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "dither.h"
+
+#define T_N 48000
+
+static float a[T_N], b[T_N];
+
+// mean power below fs/8 over mean power above 3fs/8, by DFT bins
+static double tilt_db(const float *x, int n)
+{
+    enum { BINS = 512 };
+    double lo = 0.0, hi = 0.0;
+    for (int k = 1; k < BINS; k++) {
+        double f = 0.5 * k / BINS;
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            re += x[i] * cos(2.0 * M_PI * f * i);
+            im += x[i] * sin(2.0 * M_PI * f * i);
+        }
+        double p = re * re + im * im;
+        if (f < 0.125) lo += p;
+        if (f > 0.375) hi += p;
+    }
+    return 10.0 * log10(lo / hi);
+}
+
+static int check(const char *what, bool ok)
+{
+    printf("dither_test %-36s: %s\n", what, ok ? "OK" : "FAIL");
+    return !ok;
+}
+
+int main(void)
+{
+    int fail = 0;
+    dither_t d;
+
+    // one call vs odd-sized pieces
+    dither_init(&d, 42);
+    d.mode = DITHER_SHAPED;
+    dither_block(&d, a, T_N);
+    dither_init(&d, 42);
+    d.mode = DITHER_SHAPED;
+    for (int i = 0, m = 1; i < T_N; i += m, m = m % 300 + 7)
+        dither_block(&d, b + i, i + m < T_N ? m : T_N - i);
+    fail |= check("same seed, any block split", !memcmp(a, b, sizeof(a)));
+
+    dither_init(&d, 43);
+    d.mode = DITHER_SHAPED;
+    dither_block(&d, b, T_N);
+    fail |= check("another seed, another sequence", memcmp(a, b, sizeof(a)) != 0);
+
+    // white TPDF: within +-1, mean 0, variance 1/6
+    dither_init(&d, DITHER_SEED_DEFAULT);
+    d.mode = DITHER_FLAT;
+    dither_block(&d, a, T_N);
+    double sum = 0.0, sq = 0.0, peak = 0.0;
+    for (int i = 0; i < T_N; i++) {
+        sum += a[i];
+        sq += a[i] * a[i];
+        if (fabs(a[i]) > peak) peak = fabs(a[i]);
+    }
+    double var = sq / T_N;
+    fail |= check("flat: range, mean, variance",
+                  peak < 1.0 && fabs(sum / T_N) < 0.01 && fabs(var - 1.0 / 6.0) < 0.005);
+
+    // low vs high band: flat 0 dB, HP -7.9 dB, shaped -15.5 dB (the band
+    // means of |H|^2), give or take the estimate's scatter
+    static const struct { int mode; double lo, hi; } tilt[] = {
+        { DITHER_FLAT,   -1.5,   1.5 },
+        { DITHER_HP,     -9.5,  -6.5 },
+        { DITHER_SHAPED, -17.5, -13.5 },
+    };
+    for (int t = 0; t < 3; t++) {
+        d.mode = tilt[t].mode;
+        dither_block(&d, a, 4096);
+        double db = tilt_db(a, 4096);
+        char what[64];
+        snprintf(what, sizeof(what), "%s: low/high band %.1f dB",
+                 dither_mode_name(tilt[t].mode), db);
+        fail |= check(what, db > tilt[t].lo && db < tilt[t].hi);
+    }
+
+    return fail;
+}
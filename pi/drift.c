@@ -0,0 +1,47 @@
+#include "drift.h"
+
+// Loop time constants. The fill low-pass must be much faster than the
+// loop so it only removes block/burst sawtooth, not loop dynamics.
+#define DRIFT_LOOP_TAU   10.0f  // proportional settling (s)
+#define DRIFT_INTEG_TAU  40.0f  // integral time, 4x loop tau: no overshoot
+#define DRIFT_FILL_TAU    2.0f
+#define DRIFT_MAX_PPM  1000.0f
+
+void drift_init(drift_ctl_t *d, float setpoint, float rate)
+{
+    // Plant: d(fill)/dt = rate * (drift - ppm) * 1e-6, so a P gain of
+    // 1 / (rate * 1e-6 * tau) closes the loop with time constant tau.
+    d->setpoint = setpoint;
+    d->kp = 1.0f / (rate * 1e-6f * DRIFT_LOOP_TAU);
+    d->ki = d->kp / DRIFT_INTEG_TAU;
+    d->max_ppm = DRIFT_MAX_PPM;
+    d->fill_tau = DRIFT_FILL_TAU;
+
+    d->fill_lp = setpoint;
+    d->integ = 0.0f;
+    d->ppm = 0.0f;
+}
+
+float drift_update(drift_ctl_t *d, float fill, float dt)
+{
+    float a = dt / (d->fill_tau + dt);
+    d->fill_lp += a * (fill - d->fill_lp);
+
+    float err = d->fill_lp - d->setpoint;
+    float p = d->kp * err;
+
+    // conditional integration: hold the integrator while clamped
+    float integ = d->integ + d->ki * err * dt;
+    float out = p + integ;
+
+    if (out > d->max_ppm) {
+        out = d->max_ppm;
+    } else if (out < -d->max_ppm) {
+        out = -d->max_ppm;
+    } else {
+        d->integ = integ;
+    }
+
+    d->ppm = out;
+    return out;
+}
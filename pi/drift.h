@@ -0,0 +1,37 @@
+#ifndef DRIFT_H
+#define DRIFT_H
+
+// Clock drift compensation between the S/PDIF source clock and the Pi
+// clock the SPI sender paces from.
+//
+// Measures the Pi ring fill once per block and runs a PI controller that
+// trims the resampling ratio (in ppm) to hold the fill at a setpoint.
+// Positive ppm means "produce fewer output samples".
+//
+// The Amiga STROBE is not in this loop: STROBE vs Pi drift moves the
+// Pico ring, which pico_link.h holds with a second instance of this
+// controller by trimming the SPI pacing rate.
+typedef struct {
+    float setpoint;         // target ring fill (bytes)
+    float kp;               // ppm per byte of error
+    float ki;               // ppm per byte·second of error
+    float max_ppm;          // correction limit
+    float fill_tau;         // fill low-pass time constant (s)
+
+    float fill_lp;          // filtered fill
+    float integ;            // integrator (ppm): the measured drift
+    float ppm;              // current correction
+} drift_ctl_t;
+
+#define DRIFT_SETPOINT_DEFAULT 512
+
+// rate: consumer sample rate, used to derive loop gains
+void drift_init(drift_ctl_t *d, float setpoint, float rate);
+
+// Feed one fill measurement taken dt seconds after the previous one.
+// Measure mid-block (fill after the push minus half the block's output)
+// so the block sawtooth doesn't bias the average.
+// Returns the ratio correction in ppm.
+float drift_update(drift_ctl_t *d, float fill, float dt);
+
+#endif
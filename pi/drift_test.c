@@ -0,0 +1,152 @@
+// Offline test for the drift loops: a simulated S/PDIF clock feeds the
+// real block DSP engine, the SPI sender's timer (the Pi's own clock)
+// drains the Pi ring into the Pico ring, and the Amiga STROBE drains
+// that, each off nominal by up to ±200 ppm. The Pico link reads the Pico
+// fill from a once-a-second status line (the firmware's format, through
+// the real parser) and trims the SPI pacing; the Pi loop trims the
+// resampler. After settling both rings must sit at their setpoints and
+// never run dry or full, and both corrections (averaged) must match the
+// actual clock ratios: STROBE vs Pi for the pacing, S/PDIF vs STROBE for
+// the resampler.
+#include <stdio.h>
+#include <math.h>
+
+#include "dsp.h"
+#include "drift.h"
+#include "pico_link.h"
+
+#define SIM_IN_RATE   48000.0
+#define SIM_OUT_RATE  28149.96
+#define SIM_BLOCK     256
+#define SIM_TICK      0.002     // SPI pacing tick (s)
+#define SIM_SECONDS   600.0
+#define SIM_SETTLE    200.0     // judged after this
+#define SIM_SETPOINT  512.0f
+#define SIM_PICO_RING 8192      // pico RING_SIZE
+#define SIM_PICO_START 256.0    // where the Pico ring happens to be at start
+
+// in_ppm: S/PDIF clock, pi_ppm: Pi clock, strobe_ppm: Amiga clock, all
+// against nominal
+static int run(double in_ppm, double pi_ppm, double strobe_ppm)
+{
+    static dsp_state_t dsp;
+    dsp_config_t cfg = { .gain = 1.0f, .target_rate = (float)SIM_OUT_RATE };
+    drift_ctl_t drift;
+    pico_link_t pico = { .tty = "sim" };
+    float in[SIM_BLOCK] = { 0 };
+    uint8_t out[SIM_BLOCK];
+
+    dsp_state_init(&dsp, (float)SIM_IN_RATE);
+    drift_init(&drift, SIM_SETPOINT, (float)SIM_OUT_RATE);
+    pico_link_init(&pico, (float)SIM_OUT_RATE);
+
+    const double block_dt = SIM_BLOCK / (SIM_IN_RATE * (1.0 + in_ppm * 1e-6));
+    const double per_tick = SIM_OUT_RATE * (1.0 + pi_ppm * 1e-6) * SIM_TICK;
+    const double strobe = SIM_OUT_RATE * (1.0 + strobe_ppm * 1e-6) * SIM_TICK;
+
+    double fill = SIM_SETPOINT;     // SPI starts pacing at the setpoint
+    double pico_fill = SIM_PICO_START;
+    double credit = 0.0, strobe_credit = 0.0, pace_ppm = 0.0;
+    double t_block = 0.0, t_tick = 0.0, t_report = 1.0;
+    double min_fill = 1e9, max_fill = 0.0, sum_fill = 0.0, sum_ppm = 0.0;
+    double pico_min = 1e9, pico_max = 0.0, pico_sum = 0.0, pace_sum = 0.0;
+    long samples = 0, blocks = 0, reports = 0, under = 0;
+
+    while (t_block < SIM_SECONDS) {
+        if (t_block <= t_tick) {
+            // audio thread: one block, then a fill measurement
+            int produced = dsp_process_block(&dsp, &cfg, in, out, SIM_BLOCK, NULL);
+            fill += produced;
+            dsp.drift_ppm = drift_update(&drift, (float)(fill - produced / 2),
+                                         (float)block_dt);
+            t_block += block_dt;
+
+            if (t_block > SIM_SETTLE) {
+                sum_ppm += dsp.drift_ppm;
+                blocks++;
+            }
+        } else {
+            // SPI thread: one tick of the Pi's timer, at the trimmed rate
+            credit += per_tick * (1.0 - pace_ppm * 1e-6);
+            double n = floor(credit);
+            if (n > fill) n = fill;
+            double before = fill;
+            fill -= n;
+            credit -= n;
+            pico_fill += n;
+            t_tick += SIM_TICK;
+
+            // Amiga: the STROBE edges in that tick
+            strobe_credit += strobe;
+            double k = floor(strobe_credit);
+            strobe_credit -= k;
+            if (t_tick > SIM_SETTLE && k > pico_fill)
+                under += (long)(k - pico_fill);
+            pico_fill = pico_fill > k ? pico_fill - k : 0.0;
+
+            if (t_tick > SIM_SETTLE) {
+                if (fill < min_fill) min_fill = fill;
+                if (before > max_fill) max_fill = before;
+                sum_fill += (before + fill) * 0.5;
+                if (pico_fill < pico_min) pico_min = pico_fill;
+                if (pico_fill > pico_max) pico_max = pico_fill;
+                pico_sum += pico_fill;
+                samples++;
+            }
+
+            // Pico main loop: its status line once a second
+            if (t_tick >= t_report) {
+                char line[96];
+                pico_status_t ps = { 0 };
+                snprintf(line, sizeof(line), "Ring: %u/%d, STROBE: %.1f Hz, Under: 0, Active: 1",
+                         (unsigned)pico_fill, SIM_PICO_RING, strobe / SIM_TICK);
+                if (pico_status_parse(line, &ps) < 0)
+                    return 1;
+                pace_ppm = pico_link_update(&pico, &ps, 1.0f, (uint64_t)(t_tick * 1000));
+                t_report += 1.0;
+
+                if (t_tick > SIM_SETTLE) {
+                    pace_sum += pace_ppm;
+                    reports++;
+                }
+            }
+        }
+    }
+
+    // a producer clock faster than the consumer's must be slowed: +ppm.
+    // Once both loops hold, the SPI drain runs at the STROBE rate.
+    double want_ppm = (1.0 + in_ppm * 1e-6) / (1.0 + strobe_ppm * 1e-6) * 1e6 - 1e6;
+    double want_pace = (1.0 + pi_ppm * 1e-6) / (1.0 + strobe_ppm * 1e-6) * 1e6 - 1e6;
+    double mean = sum_fill / samples;
+    double ppm = sum_ppm / blocks;
+    double pico_mean = pico_sum / samples;
+    double pace = pace_sum / reports;
+    int pico_set = pico.setpoint > 0 ? pico.setpoint : PICO_SETPOINT_DEFAULT;
+
+    int ok = min_fill > 0.0 && fabs(mean - SIM_SETPOINT) < 32.0 &&
+             fabs(ppm - want_ppm) < 5.0 &&
+             under == 0 && pico_max < SIM_PICO_RING &&
+             fabs(pico_mean - pico_set) < 32.0 && fabs(pace - want_pace) < 5.0;
+
+    printf("  in %+4.0f pi %+4.0f strobe %+4.0f: "
+           "pi ring %4.0f..%4.0f (mean %6.1f) %+7.2f ppm (want %+7.2f), "
+           "pico ring %4.0f..%4.0f (mean %6.1f) pace %+7.2f ppm (want %+7.2f)  %s\n",
+           in_ppm, pi_ppm, strobe_ppm, min_fill, max_fill, mean, ppm, want_ppm,
+           pico_min, pico_max, pico_mean, pace, want_pace, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(void)
+{
+    static const double ppm[] = { -200.0, 0.0, 200.0 };
+    int fails = 0;
+
+    printf("drift_test:\n");
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            for (int k = 0; k < 3; k++)
+                fails += run(ppm[i], ppm[j], ppm[k]);
+
+    printf("drift_test: %s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
@@ -1,74 +1,132 @@
 #include "dsp.h"
+#include "dsp_fixed.h"
 #include <math.h>
+#include <string.h>
+#include <time.h>
 
-// FIR, 14kHz cutoff @ 48kHz
-static const float fir_coeffs[FIR_TAPS] = {
-    0.000000000000000000f, -0.000009487693207800f,
-   -0.000028241026544721f, 0.000130423760155713f,
-    0.000000000000000000f, -0.000419065937722088f,
-    0.000339186194228387f, 0.000712175138665707f,
-   -0.001246734350036165f, -0.000517170810723269f,
-    0.002708786953393130f, -0.000931979532220456f,
-   -0.004077439249330360f, 0.004291842541225787f,
-    0.003865175002367077f, -0.009412796841769195f,
-    0.000000000000000010f, 0.014607065201196956f,
-   -0.009343353008992155f, -0.016288286793672682f,
-    0.024600990798602992f, 0.009104094583609177f,
-   -0.043964637021778927f, 0.014467884274793870f,
-    0.063427611801429598f, -0.071611468588267765f,
-   -0.077949100894862816f, 0.305879101861475322f,
-    0.583330847275969511f, 0.305879101861475322f,
-   -0.077949100894862816f, -0.071611468588267765f,
-    0.063427611801429612f, 0.014467884274793875f,
-   -0.043964637021778927f, 0.009104094583609180f,
-    0.024600990798602999f, -0.016288286793672689f,
-   -0.009343353008992160f, 0.014607065201196956f,
-    0.000000000000000010f, -0.009412796841769201f,
-    0.003865175002367079f, 0.004291842541225787f,
-   -0.004077439249330368f, -0.000931979532220457f,
-    0.002708786953393132f, -0.000517170810723270f,
-   -0.001246734350036166f, 0.000712175138665707f,
-    0.000339186194228387f, -0.000419065937722088f,
-    0.000000000000000000f, 0.000130423760155713f,
-   -0.000028241026544721f, -0.000009487693207800f,
-    0.000000000000000000f
-};
+#if defined(DSP_NO_SIMD)
+#define DSP_SIMD_NONE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DSP_SIMD_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define DSP_SIMD_SSE
+#else
+#define DSP_SIMD_NONE
+#endif
 
+// The taps are symmetric, so each kernel pass folds w[t] + w[N-1-t]
+// and multiplies once per pair; designs have 8k + 1 taps, so the pairs
+// come in groups of 4.
+_Static_assert((FIR_TAPS_MAX & 7) == 1, "pre-FIR lengths are 8k + 1");
 
-// Post-quantization FIR taps are the same
+// --------------------------------------------------
+// SIMD helpers
+//
+// Every kernel accumulates into four lanes and reduces them as
+// (l0 + l2) + (l1 + l3); the scalar fallbacks copy that order exactly.
+// --------------------------------------------------
+#if defined(DSP_SIMD_SSE)
+static inline float hsum4(__m128 v)
+{
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(s);
+}
+#elif defined(DSP_SIMD_NEON)
+static inline float hsum4(float32x4_t v)
+{
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(s, 0) + vget_lane_f32(s, 1);
+}
+#endif
 
-// Fast xorshift RNG
-static uint32_t rng_state = 0x12345678;
-static inline float fast_rand(void) {
-    rng_state ^= rng_state << 13;
-    rng_state ^= rng_state >> 17;
-    rng_state ^= rng_state << 5;
-    return (float)(rng_state & 0xFFFF) / 65536.0f - 0.5f;
+// dot product, n a multiple of 4
+static inline float dot_kernel(const float *a, const float *b, int n)
+{
+#if defined(DSP_SIMD_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (int t = 0; t < n; t += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + t),
+                                         _mm_loadu_ps(b + t)));
+    return hsum4(acc);
+#elif defined(DSP_SIMD_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int t = 0; t < n; t += 4)
+        acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(a + t), vld1q_f32(b + t)));
+    return hsum4(acc);
+#else
+    float l[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < n; t += 4)
+        for (int k = 0; k < 4; k++)
+            l[k] = l[k] + a[t + k] * b[t + k];
+    return (l[0] + l[2]) + (l[1] + l[3]);
+#endif
 }
 
-void dsp_init(dcblock_t *dc, fir_t *fir, postfir_t *postfir, nshaper_t *ns)
+// --------------------------------------------------
+// Symmetric FIR kernel
+//
+// w is the newest-first window. The scalar fallback is bit-identical to
+// NEON/SSE (build with -ffp-contract=off).
+// --------------------------------------------------
+static inline float fir_sym_kernel(const float *w, const float *c, int taps)
+{
+    const int pairs = taps / 2;
+#if defined(DSP_SIMD_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (int t = 0; t < pairs; t += 4) {
+        __m128 a = _mm_loadu_ps(w + t);
+        __m128 b = _mm_loadu_ps(w + taps - 4 - t);
+        b = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(c + t), _mm_add_ps(a, b)));
+    }
+    return hsum4(acc) + c[pairs] * w[pairs];
+#elif defined(DSP_SIMD_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int t = 0; t < pairs; t += 4) {
+        float32x4_t a = vld1q_f32(w + t);
+        float32x4_t b = vld1q_f32(w + taps - 4 - t);
+        b = vrev64q_f32(b);
+        b = vcombine_f32(vget_high_f32(b), vget_low_f32(b));
+        acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(c + t), vaddq_f32(a, b)));
+    }
+    return hsum4(acc) + c[pairs] * w[pairs];
+#else
+    float l[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < pairs; t += 4) {
+        for (int k = 0; k < 4; k++) {
+            float pair = w[t + k] + w[taps - 1 - t - k];
+            l[k] = l[k] + c[t + k] * pair;
+        }
+    }
+    return ((l[0] + l[2]) + (l[1] + l[3])) + c[pairs] * w[pairs];
+#endif
+}
+
+// Stage bodies are always inlined into the specialised block kernels
+// below; the exported dsp_* functions wrap them for tests and the bench.
+#define DSP_INLINE static inline __attribute__((always_inline))
+
+void dsp_init(dcblock_t *dc, fir_t *fir, nshaper_t *ns)
 {
     dc->prev_in = 0.0f;
     dc->prev_out = 0.0f;
 
-    for (int i = 0; i < FIR_TAPS; i++)
+    for (int i = 0; i < 2 * FIR_TAPS_MAX; i++)
         fir->hist[i] = 0.0f;
     fir->pos = 0;
 
-    for (int i = 0; i < POST_FIR_TAPS; i++)
-        postfir->hist[i] = 0.0f;
-    postfir->pos = 0;
-
     ns->e1 = ns->e2 = ns->e3 = 0.0f;
     ns->e1_out = ns->e2_out = 0.0f;
-    ns->dither_hp = 0.0f;
     ns->comp_env = 0.0f;
 }
 
 // --------------------------------------------------
 // DC Block
 // --------------------------------------------------
-float dsp_dcblock(dcblock_t *st, float x)
+DSP_INLINE float dcblock_step(dcblock_t *st, float x)
 {
     float y = x - st->prev_in + 0.995f * st->prev_out;
     st->prev_in = x;
@@ -76,79 +134,457 @@ float dsp_dcblock(dcblock_t *st, float x)
     return y;
 }
 
+float dsp_dcblock(dcblock_t *st, float x) { return dcblock_step(st, x); }
+
 // --------------------------------------------------
 // Pre-FIR
 // --------------------------------------------------
-float dsp_fir(fir_t *st, float x)
+DSP_INLINE float fir_step(fir_t *st, float x)
 {
+    if (--st->pos < 0) st->pos = st->taps - 1;
     st->hist[st->pos] = x;
-    float acc = 0.0f;
-    int idx = st->pos;
+    st->hist[st->pos + st->taps] = x;
+    return fir_sym_kernel(&st->hist[st->pos], st->coef, st->taps);
+}
+
+float dsp_fir(fir_t *st, float x) { return fir_step(st, x); }
+
+// --------------------------------------------------
+// Polyphase resampler
+// --------------------------------------------------
 
-    for (int t = 0; t < FIR_TAPS; t++) {
-        acc += fir_coeffs[t] * st->hist[idx];
-        if (--idx < 0) idx = FIR_TAPS - 1;
+// zeroth-order modified Bessel function (Kaiser window)
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
     }
-    if (++st->pos >= FIR_TAPS) st->pos = 0;
-    return acc;
+    return sum;
+}
+
+#define RS_KAISER_BETA 7.0
+
+static void resampler_design(float table[RS_PHASES + 1][RS_TAPS],
+                             float in_rate, float cutoff_hz)
+{
+    // Kaiser-windowed sinc, sampled at RS_PHASES offsets per input
+    // sample. Row p is the filter for an output p/RS_PHASES samples
+    // older than the newest input.
+    const double fc = cutoff_hz / in_rate;
+    const double half = RS_TAPS / 2.0;
+    const double delay = half - 1.0;
+    const double i0b = bessel_i0(RS_KAISER_BETA);
+
+    for (int p = 0; p <= RS_PHASES; p++) {
+        double sum = 0.0;
+        double row[RS_TAPS];
+
+        for (int k = 0; k < RS_TAPS; k++) {
+            double u = k - (double)p / RS_PHASES - delay;
+            double x = 2.0 * fc * u;
+            double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double r = u / half;
+            double win = (r * r < 1.0)
+                ? bessel_i0(RS_KAISER_BETA * sqrt(1.0 - r * r)) / i0b : 0.0;
+            row[k] = 2.0 * fc * sinc * win;
+            sum += row[k];
+        }
+        for (int k = 0; k < RS_TAPS; k++)
+            table[p][k] = (float)(row[k] / sum);   // unity DC gain
+    }
+}
+
+void dsp_resampler_init(resampler_t *rs, float in_rate, float cutoff_hz)
+{
+    resampler_design(rs->table, in_rate, cutoff_hz);
+
+    for (int i = 0; i < 2 * RS_TAPS; i++)
+        rs->hist[i] = 0.0f;
+    rs->pos = 0;
+    rs->t = 0.0;
+    rs->step = 1.0;
+}
+
+void dsp_resampler_set_rate(resampler_t *rs, float in_rate, float out_rate)
+{
+    double step = (double)in_rate / (double)out_rate;
+    rs->step = (step < 1.0) ? 1.0 : step;   // decimation only
+}
+
+DSP_INLINE int resample_step(resampler_t *rs, float x, bool filter, float *y)
+{
+    if (--rs->pos < 0) rs->pos = RS_TAPS - 1;
+    rs->hist[rs->pos] = x;
+    rs->hist[rs->pos + RS_TAPS] = x;
+
+    rs->t -= 1.0;
+    if (rs->t > 0.0)
+        return 0;
+
+    // output instant lies d samples before the newest input
+    float d = (float)-rs->t;
+    rs->t += rs->step;
+
+    const float *w = &rs->hist[rs->pos];
+
+    if (!filter) {
+        *y = w[0] + d * (w[1] - w[0]);
+        return 1;
+    }
+
+    float fp = d * RS_PHASES;
+    int p = (int)fp;
+    if (p >= RS_PHASES) p = RS_PHASES - 1;
+    float frac = fp - (float)p;
+
+    float y0 = dot_kernel(rs->table[p], w, RS_TAPS);
+    float y1 = dot_kernel(rs->table[p + 1], w, RS_TAPS);
+    *y = y0 + frac * (y1 - y0);
+    return 1;
+}
+
+int dsp_resample(resampler_t *rs, float x, bool filter, float *y)
+{
+    return resample_step(rs, x, filter, y);
 }
 
 // --------------------------------------------------
-// Post-FIR
+// Pre-FIR design
+//
+// Kaiser's estimates give beta and a first length for FIR_STOP_DB over
+// the transition band; the length is then checked against the actual
+// response and moved in steps of 8 until it is the shortest that meets
+// the spec, since the estimate is off by a tap or two either way.
 // --------------------------------------------------
-float dsp_postfir(postfir_t *st, float x)
+
+// passband and stopband edges, Hz
+static void fir_edges(float in_rate, float out_rate, double *pass, double *stop)
 {
-    st->hist[st->pos] = x;
-    float acc = 0.0f;
-    int idx = st->pos;
+    double nyq = (out_rate > 0.0f && out_rate < in_rate ? out_rate : in_rate) / 2.0;
+    *stop = nyq;
+    *pass = nyq * FIR_PASS_FRAC;
+}
+
+float dsp_fir_cutoff(float in_rate, float out_rate)
+{
+    double pass, stop;
+    fir_edges(in_rate, out_rate, &pass, &stop);
+    return (float)((pass + stop) / 2.0);
+}
+
+static void fir_kaiser(float *coef, int taps, double fc, double beta)
+{
+    const double mid = (taps - 1) / 2.0;
+    const double i0b = bessel_i0(beta);
+    double h[FIR_TAPS_MAX];
+    double sum = 0.0;
+
+    for (int k = 0; k < taps; k++) {
+        double u = k - mid;
+        double x = 2.0 * fc * u;
+        double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double r = u / mid;
+        h[k] = 2.0 * fc * sinc * bessel_i0(beta * sqrt(1.0 - r * r)) / i0b;
+        sum += h[k];
+    }
+    for (int k = 0; k < taps; k++)
+        coef[k] = (float)(h[k] / sum);     // unity DC gain
+}
+
+double dsp_fir_stopband_db(const float *coef, int n, float in_rate, float out_rate)
+{
+    double pass, stop;
+    fir_edges(in_rate, out_rate, &pass, &stop);
+
+    // H = c[M] + 2 sum c[M-k] cos(k w), cos(k w) by recurrence; a grid
+    // of 8 points per 1/n of the band catches every sidelobe's peak
+    const int m = n / 2;
+    const double w0 = 2.0 * M_PI * stop / in_rate;
+    const int points = 8 * n;
+    double peak = 0.0;
+
+    for (int g = 0; g <= points; g++) {
+        double w = w0 + (M_PI - w0) * g / points;
+        double c1 = cos(w), ck1 = 1.0, ck = c1;
+        double h = coef[m];
+        for (int k = 1; k <= m; k++) {
+            h += 2.0 * coef[m - k] * ck;
+            double next = 2.0 * c1 * ck - ck1;
+            ck1 = ck;
+            ck = next;
+        }
+        if (fabs(h) > peak) peak = fabs(h);
+    }
+    return 20.0 * log10(peak > 1e-12 ? peak : 1e-12);
+}
 
-    for (int t = 0; t < POST_FIR_TAPS; t++) {
-        acc += fir_coeffs[t] * st->hist[idx];
-        if (--idx < 0) idx = POST_FIR_TAPS - 1;
+int dsp_fir_design(float *coef, float in_rate, float out_rate)
+{
+    double pass, stop;
+    fir_edges(in_rate, out_rate, &pass, &stop);
+
+    const double a = FIR_STOP_DB;
+    const double beta = 0.1102 * (a - 8.7);
+    const double fc = (pass + stop) / 2.0 / in_rate;
+    double order = (a - 7.95) / (14.36 * (stop - pass) / in_rate);
+
+    int taps = ((int)ceil(order) + 7) / 8 * 8 + 1;
+    if (taps < 9) taps = 9;
+    if (taps > FIR_TAPS_MAX) taps = FIR_TAPS_MAX;
+
+    // shorter while it still meets the spec, longer until it does
+    fir_kaiser(coef, taps, fc, beta);
+    bool ok = dsp_fir_stopband_db(coef, taps, in_rate, out_rate) <= -a;
+    while (ok && taps > 9) {
+        fir_kaiser(coef, taps - 8, fc, beta);
+        if (dsp_fir_stopband_db(coef, taps - 8, in_rate, out_rate) > -a)
+            break;
+        taps -= 8;
     }
-    if (++st->pos >= POST_FIR_TAPS) st->pos = 0;
-    return acc;
+    while (!ok && taps < FIR_TAPS_MAX) {
+        taps += 8;
+        fir_kaiser(coef, taps, fc, beta);
+        ok = dsp_fir_stopband_db(coef, taps, in_rate, out_rate) <= -a;
+    }
+
+    fir_kaiser(coef, taps, fc, beta);
+    return taps;
 }
 
 // --------------------------------------------------
 // Compressor
 // --------------------------------------------------
-float dsp_compress(nshaper_t *st, float x)
+#define COMP_CHUNK 64       // envelopes held between the two passes
+
+void dsp_dynamics_set(dsp_dynamics_t *d, const dsp_config_t *cfg, float rate)
 {
-    float env = fabsf(x);
-    if (env > st->comp_env)
-        st->comp_env = st->comp_env * 0.95f + env * 0.05f;
-    else
-        st->comp_env = st->comp_env * 0.9999f + env * 0.0001f;
+    float ratio = cfg->comp_ratio > 0.0f ? cfg->comp_ratio : DSP_COMP_RATIO_DEFAULT;
+    float key[5] = {
+        cfg->comp_threshold > 0.0f ? cfg->comp_threshold : DSP_COMP_THRESHOLD_DEFAULT,
+        ratio > 1.0f ? ratio : 1.0f,
+        cfg->comp_attack_ms > 0.0f ? cfg->comp_attack_ms : DSP_COMP_ATTACK_MS_DEFAULT,
+        cfg->comp_release_ms > 0.0f ? cfg->comp_release_ms : DSP_COMP_RELEASE_MS_DEFAULT,
+        rate,
+    };
+    if (!memcmp(key, d->key, sizeof(key)))
+        return;
+    memcpy(d->key, key, sizeof(key));
+
+    // one-pole follower: time constant ms at rate
+    d->att = expf(-1000.0f / (key[2] * rate));
+    d->rel = expf(-1000.0f / (key[3] * rate));
+    d->att_in = 1.0f - d->att;
+    d->rel_in = 1.0f - d->rel;
 
-    float th = 0.7f;
-    if (st->comp_env > th) {
-        float over = st->comp_env - th;
-        float gain = (th + over * 0.33f) / st->comp_env;
-        x *= gain;
+    d->threshold = key[0];
+    d->slope = 1.0f / key[1];
+    d->knee = d->threshold * (1.0f - d->slope);
+}
+
+DSP_INLINE void compress_chunk(nshaper_t *st, const dsp_dynamics_t *d,
+                               float *x, int n)
+{
+    float envs[COMP_CHUNK];
+    float env = st->comp_env;
+
+    // envelope: serial, but attack vs release is a select, not a branch
+    for (int i = 0; i < n; i++) {
+        float ax = fabsf(x[i]);
+        bool up = ax > env;
+        env = env * (up ? d->att : d->rel) + ax * (up ? d->att_in : d->rel_in);
+        envs[i] = env;
+    }
+    st->comp_env = env;
+
+    // (th + (env - th) * slope) / env above the threshold, 1 below, is
+    // min(1, slope + knee / env); env = 0 gives +inf there, no special case
+    for (int i = 0; i < n; i++) {
+        float g = d->slope + d->knee / envs[i];
+        x[i] *= g < 1.0f ? g : 1.0f;
     }
-    return x;
+}
+
+DSP_INLINE void compress_block(nshaper_t *st, const dsp_dynamics_t *d,
+                               float *x, int n)
+{
+    for (int base = 0; base < n; base += COMP_CHUNK)
+        compress_chunk(st, d, x + base, n - base < COMP_CHUNK ? n - base : COMP_CHUNK);
+}
+
+void dsp_compress_block(nshaper_t *st, const dsp_dynamics_t *dyn, float *x, int n)
+{
+    compress_block(st, dyn, x, n);
 }
 
 // --------------------------------------------------
 // Soft Saturator
 // --------------------------------------------------
-float dsp_saturate(float x)
+// 0.8 + 0.2 * (1 - (1 - t)^2), t = (|x| - 0.8) / 0.7: linear below 0.8,
+// 1.0 past 1.5. With t clamped to 0..1 and min(|x|, 0.8) as the linear
+// part, all three segments are one expression; below the knee t = 0
+// adds exactly 0, so the result is bit-identical to the branchy form.
+DSP_INLINE float saturate_step(float x)
 {
     float ax = fabsf(x);
-    if (ax < 0.8f) return x;
-    if (ax > 1.5f) return (x > 0) ? 1.0f : -1.0f;
-
     float t = (ax - 0.8f) / 0.7f;
-    float s = 0.8f + 0.2f * (1.0f - (1.0f - t) * (1.0f - t));
-    return (x > 0 ? s : -s);
+    t = t > 0.0f ? t : 0.0f;
+    t = t < 1.0f ? t : 1.0f;
+    float u = 1.0f - t;
+    float lin = ax < 0.8f ? ax : 0.8f;
+    return copysignf(lin + 0.2f * (1.0f - u * u), x);
+}
+
+void dsp_saturate_block(float *x, int n)
+{
+    for (int i = 0; i < n; i++)
+        x[i] = saturate_step(x[i]);
+}
+
+// --------------------------------------------------
+// Halfband oversampler (compressor + saturator)
+//
+// Taps are numbered by offset n = 2j - (taps - 1) from the centre, all
+// odd. Upsampling a sample gives two outputs: the older phase is just
+// the input delayed (the 1/2 centre tap, times the zero-stuffing gain
+// of 2), the newer one a dot product over the odd taps. Decimating a
+// pair is the same two phases added, at the output rate only.
+//
+// Blocks run over [history | chunk] in time order, which the symmetric
+// taps allow, so the windows are contiguous without a ring.
+// --------------------------------------------------
+#define HB_KAISER_BETA 6.0
+#define HB_BLOCK 256                // input samples per oversampler pass
+#define HB_CHUNK (2 * HB_BLOCK)     // longest run one halfband sees
+
+static void halfband_design(halfband_t *hb, int taps)
+{
+    const double half = taps;   // window reaches just past the outer taps
+    const double i0b = bessel_i0(HB_KAISER_BETA);
+    double sum = 0.0;
+    double c[HB_TAPS_1];
+
+    for (int j = 0; j < taps; j++) {
+        double n = 2 * j - (taps - 1);
+        double r = n / half;
+        c[j] = sin(M_PI * n / 2.0) / (M_PI * n)
+             * bessel_i0(HB_KAISER_BETA * sqrt(1.0 - r * r)) / i0b;
+        sum += c[j];
+    }
+    for (int j = 0; j < taps; j++)
+        hb->coef[j] = (float)(c[j] * 0.5 / sum);    // + 1/2 centre = unity DC
+}
+
+// x: n <= HB_CHUNK samples in, y: 2n out. taps is a constant at every
+// call, so the dot products unroll.
+DSP_INLINE void hb_up(halfband_t *hb, const float *x, float *y, int n,
+                      const int taps)
+{
+    float buf[HB_TAPS_1 - 1 + HB_CHUNK];
+    memcpy(buf, hb->up, (taps - 1) * sizeof(float));
+    memcpy(buf + taps - 1, x, n * sizeof(float));
+
+    for (int i = 0; i < n; i++) {
+        const float *w = buf + i;   // oldest first, w[taps - 1] = x[i]
+        y[2 * i] = w[taps / 2 - 1];
+        y[2 * i + 1] = 2.0f * dot_kernel(hb->coef, w, taps);
+    }
+    memcpy(hb->up, buf + n, (taps - 1) * sizeof(float));
+}
+
+// y: 2n samples in, x: n out
+DSP_INLINE void hb_down(halfband_t *hb, const float *y, float *x, int n,
+                        const int taps)
+{
+    float mid[HB_TAPS_1 - 1 + HB_CHUNK], tap[HB_TAPS_1 - 1 + HB_CHUNK];
+    memcpy(mid, hb->mid, (taps - 1) * sizeof(float));
+    memcpy(tap, hb->tap, (taps - 1) * sizeof(float));
+    for (int i = 0; i < n; i++) {
+        mid[taps - 1 + i] = y[2 * i];
+        tap[taps - 1 + i] = y[2 * i + 1];
+    }
+
+    for (int i = 0; i < n; i++)
+        x[i] = dot_kernel(hb->coef, tap + i, taps) + 0.5f * mid[i + taps / 2];
+
+    memcpy(hb->mid, mid + n, (taps - 1) * sizeof(float));
+    memcpy(hb->tap, tap + n, (taps - 1) * sizeof(float));
+}
+
+void dsp_oversampler_reset(oversampler_t *os, int factor)
+{
+    halfband_design(&os->hb[0], HB_TAPS_1);
+    halfband_design(&os->hb[1], HB_TAPS_2);
+    for (int s = 0; s < 2; s++) {
+        memset(os->hb[s].up, 0, sizeof(os->hb[s].up));
+        memset(os->hb[s].mid, 0, sizeof(os->hb[s].mid));
+        memset(os->hb[s].tap, 0, sizeof(os->hb[s].tap));
+    }
+    os->factor = factor;
+}
+
+// n <= HB_BLOCK; hi holds factor * n
+DSP_INLINE void oversample_up(oversampler_t *os, const float *x, float *hi, int n)
+{
+    if (os->factor == 4) {
+        float mid[2 * HB_BLOCK];
+        hb_up(&os->hb[0], x, mid, n, HB_TAPS_1);
+        hb_up(&os->hb[1], mid, hi, 2 * n, HB_TAPS_2);
+    } else if (os->factor == 2) {
+        hb_up(&os->hb[0], x, hi, n, HB_TAPS_1);
+    } else {
+        memmove(hi, x, n * sizeof(float));
+    }
+}
+
+DSP_INLINE void oversample_down(oversampler_t *os, const float *hi, float *x, int n)
+{
+    if (os->factor == 4) {
+        float mid[2 * HB_BLOCK];
+        hb_down(&os->hb[1], hi, mid, 2 * n, HB_TAPS_2);
+        hb_down(&os->hb[0], mid, x, n, HB_TAPS_1);
+    } else if (os->factor == 2) {
+        hb_down(&os->hb[0], hi, x, n, HB_TAPS_1);
+    } else {
+        memmove(x, hi, n * sizeof(float));
+    }
+}
+
+void dsp_oversample_up(oversampler_t *os, const float *x, float *hi, int n)
+{
+    for (int base = 0; base < n; base += HB_BLOCK) {
+        int m = n - base < HB_BLOCK ? n - base : HB_BLOCK;
+        oversample_up(os, x + base, hi + base * os->factor, m);
+    }
+}
+
+void dsp_oversample_down(oversampler_t *os, const float *hi, float *x, int n)
+{
+    for (int base = 0; base < n; base += HB_BLOCK) {
+        int m = n - base < HB_BLOCK ? n - base : HB_BLOCK;
+        oversample_down(os, hi + base * os->factor, x + base, m);
+    }
+}
+
+// roundf(), half away from zero, in operations that vectorise: the
+// fraction left after truncation is exact, so this is bit-identical
+DSP_INLINE float round_half_away(float r)
+{
+    float t = truncf(r);
+    float frac = r - t;
+    t += frac >= 0.5f ? 1.0f : 0.0f;
+    t -= frac <= -0.5f ? 1.0f : 0.0f;
+    return t;
 }
 
 // --------------------------------------------------
 // Oversample Quantizer (48k)
 // --------------------------------------------------
-float dsp_quantize_oversample(nshaper_t *st, float x,
-                              bool shape, bool dither)
+// dither: one dither_block() sample, added at 0.5/256 of full scale
+DSP_INLINE float qover_step(nshaper_t *st, float x, bool shape,
+                            bool dithered, float dither)
 {
     float shaped = x;
 
@@ -156,34 +592,40 @@ float dsp_quantize_oversample(nshaper_t *st, float x,
         shaped = x + 1.8f * st->e1 - 1.1f * st->e2 + 0.3f * st->e3;
     }
 
-    if (dither) {
-        float white = fast_rand() + fast_rand();
-        float hp = white - st->dither_hp;
-        st->dither_hp = white * 0.5f;
-        shaped += hp * (0.5f / 256.0f);
-    }
+    if (dithered)
+        shaped += dither * (0.5f / 256.0f);
 
     if (shaped > 0.98f) shaped = 0.98f;
     if (shaped < -0.98f) shaped = -0.98f;
 
-    int q = (int)roundf(shaped * 127.0f);
-    float quantized = (float)q / 127.0f;
+    // shaped, the loop is serial and roundf is cheaper; otherwise
+    // round_half_away lets it vectorise (same result), dithered or not
+    float r = shape ? roundf(shaped * 127.0f)
+                    : round_half_away(shaped * 127.0f);
+    float quantized = r / 127.0f;
 
     if (shape) {
         st->e3 = st->e2;
         st->e2 = st->e1;
         st->e1 = shaped - quantized;
-    } else {
-        st->e1 = st->e2 = st->e3 = 0.0f;
     }
 
     return quantized;
 }
 
+float dsp_quantize_oversample(nshaper_t *st, float x,
+                              bool shape, float dither)
+{
+    float q = qover_step(st, x, shape, true, dither);
+    if (!shape)
+        st->e1 = st->e2 = st->e3 = 0.0f;
+    return q;
+}
+
 // --------------------------------------------------
 // Final Quantizer (8-bit @ target_rate)
 // --------------------------------------------------
-uint8_t dsp_quantize_final(nshaper_t *st, float x, bool shape)
+DSP_INLINE uint8_t qfinal_step(nshaper_t *st, float x, bool shape)
 {
     float shaped = x;
     if (shape) {
@@ -193,19 +635,401 @@ uint8_t dsp_quantize_final(nshaper_t *st, float x, bool shape)
     if (shaped > 0.98f) shaped = 0.98f;
     if (shaped < -0.98f) shaped = -0.98f;
 
-    int q = (int)roundf(shaped * 127.0f);
-    float quant = (float)q / 127.0f;
+    float r = roundf(shaped * 127.0f);
+    float quant = r / 127.0f;
 
     if (shape) {
         st->e2_out = st->e1_out;
         st->e1_out = shaped - quant;
-    } else {
-        st->e1_out = st->e2_out = 0.0f;
     }
 
-    q += 128;
+    int q = (int)r + 128;
     if (q < 0) q = 0;
     if (q > 255) q = 255;
     return (uint8_t)q;
 }
 
+uint8_t dsp_quantize_final(nshaper_t *st, float x, bool shape)
+{
+    uint8_t q = qfinal_step(st, x, shape);
+    if (!shape)
+        st->e1_out = st->e2_out = 0.0f;
+    return q;
+}
+
+
+// --------------------------------------------------
+// Block statistics
+//
+// x: samples into the oversample quantizer, q: its output. Reduced
+// after the serial chain so the sums vectorise; lane order makes them
+// differ from a serial sum in the last bits, which the meters don't see.
+// --------------------------------------------------
+#define DSP_CLIP_LEVEL  0.99f
+#define DSP_STATS_CHUNK 256     // samples kept for one reduction
+
+_Static_assert(DSP_STATS_CHUNK <= HB_BLOCK, "a chunk is one oversampler pass");
+
+static void block_reduce(const float *x, const float *q, int n,
+                         dsp_block_stats_t *st)
+{
+    int i = 0;
+    float abs_sum, abs_peak, qerr_sum, dc_sum;
+    int clips = 0;
+
+#if defined(DSP_SIMD_SSE)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 clip = _mm_set1_ps(DSP_CLIP_LEVEL);
+    __m128 s_abs = _mm_setzero_ps(), s_pk = _mm_setzero_ps();
+    __m128 s_qe = _mm_setzero_ps(), s_dc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128 a = _mm_andnot_ps(sign, v);
+        __m128 e = _mm_andnot_ps(sign, _mm_sub_ps(v, _mm_loadu_ps(q + i)));
+        s_abs = _mm_add_ps(s_abs, a);
+        s_pk  = _mm_max_ps(s_pk, a);
+        s_qe  = _mm_add_ps(s_qe, e);
+        s_dc  = _mm_add_ps(s_dc, v);
+        clips += __builtin_popcount(_mm_movemask_ps(_mm_cmpge_ps(a, clip)));
+    }
+    float pk[4];
+    _mm_storeu_ps(pk, s_pk);
+    abs_sum = hsum4(s_abs);
+    qerr_sum = hsum4(s_qe);
+    dc_sum = hsum4(s_dc);
+    abs_peak = fmaxf(fmaxf(pk[0], pk[1]), fmaxf(pk[2], pk[3]));
+#elif defined(DSP_SIMD_NEON)
+    const float32x4_t clip = vdupq_n_f32(DSP_CLIP_LEVEL);
+    float32x4_t s_abs = vdupq_n_f32(0.0f), s_pk = vdupq_n_f32(0.0f);
+    float32x4_t s_qe = vdupq_n_f32(0.0f), s_dc = vdupq_n_f32(0.0f);
+    uint32x4_t s_clip = vdupq_n_u32(0);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        float32x4_t a = vabsq_f32(v);
+        float32x4_t e = vabsq_f32(vsubq_f32(v, vld1q_f32(q + i)));
+        s_abs = vaddq_f32(s_abs, a);
+        s_pk  = vmaxq_f32(s_pk, a);
+        s_qe  = vaddq_f32(s_qe, e);
+        s_dc  = vaddq_f32(s_dc, v);
+        s_clip = vsubq_u32(s_clip, vcgeq_f32(a, clip));    // true = ~0 = -1
+    }
+    abs_sum = hsum4(s_abs);
+    qerr_sum = hsum4(s_qe);
+    dc_sum = hsum4(s_dc);
+    float32x2_t p2 = vpmax_f32(vget_low_f32(s_pk), vget_high_f32(s_pk));
+    abs_peak = fmaxf(vget_lane_f32(p2, 0), vget_lane_f32(p2, 1));
+    uint32x2_t c2 = vadd_u32(vget_low_u32(s_clip), vget_high_u32(s_clip));
+    clips = (int)(vget_lane_u32(c2, 0) + vget_lane_u32(c2, 1));
+#else
+    abs_sum = abs_peak = qerr_sum = dc_sum = 0.0f;
+#endif
+
+    for (; i < n; i++) {
+        float ax = fabsf(x[i]);
+        abs_sum += ax;
+        if (ax > abs_peak) abs_peak = ax;
+        if (ax >= DSP_CLIP_LEVEL) clips++;
+        qerr_sum += fabsf(x[i] - q[i]);
+        dc_sum += x[i];
+    }
+
+    st->abs_sum += abs_sum;
+    if (abs_peak > st->abs_peak) st->abs_peak = abs_peak;
+    st->qerr_sum += qerr_sum;
+    st->dc_sum += dc_sum;
+    st->clips += clips;
+    st->samples += n;
+}
+
+// --------------------------------------------------
+// Block engine
+// --------------------------------------------------
+void dsp_filters_set(dsp_state_t *st, float in_rate, float out_rate)
+{
+    dsp_filters_t *d = &st->designs[st->design_cur];
+    if (d->in_rate == in_rate && d->out_rate == out_rate)
+        return;
+
+    int i = 0;
+    while (i < FIR_DESIGNS && !(st->designs[i].in_rate == in_rate &&
+                                st->designs[i].out_rate == out_rate))
+        i++;
+    if (i == FIR_DESIGNS) {
+        i = st->design_next;
+        st->design_next = (i + 1) % FIR_DESIGNS;
+        d = &st->designs[i];
+        d->in_rate = in_rate;
+        d->out_rate = out_rate;
+        d->taps = dsp_fir_design(d->fir, in_rate, out_rate);
+        float cutoff = dsp_fir_cutoff(in_rate, out_rate);
+        resampler_design(d->rs, in_rate, cutoff < RS_CUTOFF_HZ ? cutoff : RS_CUTOFF_HZ);
+    }
+    st->design_cur = i;
+    d = &st->designs[i];
+
+    // the resampler keeps its history (same length); a FIR of another
+    // length starts from silence
+    if (d->taps != st->fir.taps) {
+        memset(st->fir.hist, 0, sizeof(st->fir.hist));
+        st->fir.taps = d->taps;
+        st->fir.pos = 0;
+    }
+    memcpy(st->fir.coef, d->fir, d->taps * sizeof(float));
+    memcpy(st->rs.table, d->rs, sizeof(d->rs));
+    dsp_fixed_set_filters(&st->fx, &st->fir, &st->rs);
+}
+
+void dsp_set_src_rate(dsp_state_t *st, float src_rate)
+{
+    int factor = 1;
+    while (factor < DSP_OVERSAMPLE_MAX && src_rate / factor > DSP_BASE_RATE_MAX)
+        factor *= 2;
+
+    dsp_oversampler_reset(&st->dec, factor);
+    st->dec_held = 0;
+    st->src_rate = src_rate;
+    st->in_rate = src_rate / factor;
+}
+
+void dsp_state_init(dsp_state_t *st, float src_rate)
+{
+    dsp_set_src_rate(st, src_rate);
+    const float in_rate = st->in_rate;
+
+    dsp_init(&st->dc, &st->fir, &st->ns);
+    dsp_resampler_init(&st->rs, in_rate, RS_CUTOFF_HZ);
+    memset(st->designs, 0, sizeof(st->designs));
+    st->design_cur = st->design_next = 0;
+    st->fir.taps = 0;
+    st->drift_ppm = 0.0f;
+    st->fixed = DSP_FIXED_DEFAULT;
+    memset(&st->dyn, 0, sizeof(st->dyn));
+    dsp_dynamics_set(&st->dyn, &(dsp_config_t){ 0 }, in_rate);
+    dsp_oversampler_reset(&st->os, 1);
+    dither_init(&st->dith, DITHER_SEED_DEFAULT);
+    dsp_fixed_init(&st->fx, &st->fir, &st->rs);
+    dsp_fixed_set_dynamics(&st->fx, &st->dyn);
+    dsp_filters_set(st, in_rate, in_rate);
+}
+
+// --------------------------------------------------
+// Specialised block kernels
+//
+// chain_block() is written once against five flags; DSP_KERNEL stamps
+// out a copy for each combination with the flags as constants, so a
+// stage that is off is not in the code at all. The chain runs stage by
+// stage over a chunk (every stage keeps its own state, so the result is
+// the same as sample by sample), which leaves the unshaped, undithered
+// quantiser a pure map the compiler can vectorise.
+// --------------------------------------------------
+static inline uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+DSP_INLINE void nonlinear_block(dsp_state_t *st, float *x, int n,
+                                const bool compress, const bool saturate)
+{
+    if (compress)
+        compress_block(&st->ns, &st->dyn, x, n);
+
+    if (saturate)
+        for (int i = 0; i < n; i++)
+            x[i] = saturate_step(x[i]);
+}
+
+// x: n <= DSP_STATS_CHUNK samples, in place; timed into the stats
+DSP_INLINE void nonlinear_oversampled(dsp_state_t *st, float *x, int n,
+                                      dsp_block_stats_t *stats,
+                                      const bool compress, const bool saturate)
+{
+    float hi[DSP_OVERSAMPLE_MAX * DSP_STATS_CHUNK];
+    uint64_t t0 = stats ? clock_ns() : 0;
+
+    oversample_up(&st->os, x, hi, n);
+    nonlinear_block(st, hi, n * st->os.factor, compress, saturate);
+    oversample_down(&st->os, hi, x, n);
+
+    if (stats)
+        stats->os_ns += clock_ns() - t0;
+}
+
+typedef int (*dsp_kernel_t)(dsp_state_t *st, const float *in, uint8_t *out,
+                            int n, dsp_block_stats_t *stats);
+
+DSP_INLINE int chain_block(dsp_state_t *st, const float *in, uint8_t *out,
+                           int n, dsp_block_stats_t *stats,
+                           const bool filter, const bool compress,
+                           const bool saturate, const bool shape,
+                           const bool dither)
+{
+    // error feedback state only lives while shaping is on
+    if (!shape) {
+        st->ns.e1 = st->ns.e2 = st->ns.e3 = 0.0f;
+        st->ns.e1_out = st->ns.e2_out = 0.0f;
+    }
+
+    // x: into the oversample quantizer (kept for the stats), q: out of
+    // it, d: its dither, made a chunk ahead
+    float xs[DSP_STATS_CHUNK], qs[DSP_STATS_CHUNK], ds[DSP_STATS_CHUNK];
+    int produced = 0;
+
+    for (int base = 0; base < n; base += DSP_STATS_CHUNK) {
+        int m = n - base < DSP_STATS_CHUNK ? n - base : DSP_STATS_CHUNK;
+        const float *src = in + base;
+
+        for (int i = 0; i < m; i++)
+            xs[i] = dcblock_step(&st->dc, src[i]);
+
+        if (filter)
+            for (int i = 0; i < m; i++)
+                xs[i] = fir_step(&st->fir, xs[i]);
+
+        if ((compress || saturate) && st->os.factor > 1)
+            nonlinear_oversampled(st, xs, m, stats, compress, saturate);
+        else
+            nonlinear_block(st, xs, m, compress, saturate);
+
+        if (dither)
+            dither_block(&st->dith, ds, m);
+
+        for (int i = 0; i < m; i++)
+            qs[i] = qover_step(&st->ns, xs[i], shape, dither, dither ? ds[i] : 0.0f);
+
+        // resample in_rate → target_rate
+        for (int i = 0; i < m; i++) {
+            float qf;
+            if (resample_step(&st->rs, qs[i], filter, &qf))
+                out[produced++] = qfinal_step(&st->ns, qf, shape);
+        }
+
+        if (stats)
+            block_reduce(xs, qs, m, stats);
+    }
+    return produced;
+}
+
+#define DSP_KEY(f, c, s, sh, d) \
+    ((f) | (c) << 1 | (s) << 2 | (sh) << 3 | (d) << 4)
+
+#define DSP_KERNEL(f, c, s, sh, d)                                          \
+    static int kernel_##f##c##s##sh##d(dsp_state_t *st, const float *in,    \
+                                       uint8_t *out, int n,                 \
+                                       dsp_block_stats_t *stats)            \
+    {                                                                       \
+        return chain_block(st, in, out, n, stats, f, c, s, sh, d);          \
+    }
+
+#define DSP_KERNELS_D(f, c, s, sh) DSP_KERNEL(f, c, s, sh, 0) DSP_KERNEL(f, c, s, sh, 1)
+#define DSP_KERNELS_SH(f, c, s)    DSP_KERNELS_D(f, c, s, 0) DSP_KERNELS_D(f, c, s, 1)
+#define DSP_KERNELS_S(f, c)        DSP_KERNELS_SH(f, c, 0) DSP_KERNELS_SH(f, c, 1)
+#define DSP_KERNELS_C(f)           DSP_KERNELS_S(f, 0) DSP_KERNELS_S(f, 1)
+DSP_KERNELS_C(0)
+DSP_KERNELS_C(1)
+
+#define DSP_ENTRY(f, c, s, sh, d) [DSP_KEY(f, c, s, sh, d)] = kernel_##f##c##s##sh##d,
+#define DSP_ENTRIES_D(f, c, s, sh) DSP_ENTRY(f, c, s, sh, 0) DSP_ENTRY(f, c, s, sh, 1)
+#define DSP_ENTRIES_SH(f, c, s)    DSP_ENTRIES_D(f, c, s, 0) DSP_ENTRIES_D(f, c, s, 1)
+#define DSP_ENTRIES_S(f, c)        DSP_ENTRIES_SH(f, c, 0) DSP_ENTRIES_SH(f, c, 1)
+#define DSP_ENTRIES_C(f)           DSP_ENTRIES_S(f, 0) DSP_ENTRIES_S(f, 1)
+
+static const dsp_kernel_t dsp_kernels[32] = {
+    DSP_ENTRIES_C(0)
+    DSP_ENTRIES_C(1)
+};
+
+// One block at in_rate
+static int chain_process(dsp_state_t *st, const dsp_config_t *cfg,
+                         const float *in, uint8_t *out, int n,
+                         dsp_block_stats_t *stats)
+{
+    // config is sampled once per block
+    dsp_filters_set(st, st->in_rate, cfg->target_rate);
+    dsp_resampler_set_rate(&st->rs, st->in_rate, cfg->target_rate);
+    st->rs.step *= 1.0 + st->drift_ppm * 1e-6;
+
+    // a new factor starts from clear halfband histories
+    int factor = st->fixed ? 1 : cfg->oversample >= 4 ? 4 : cfg->oversample >= 2 ? 2 : 1;
+    if (factor != st->os.factor)
+        dsp_oversampler_reset(&st->os, factor);
+    if (cfg->compress)
+        dsp_dynamics_set(&st->dyn, cfg, st->in_rate * factor);
+
+    // a new seed restarts the dither sequence
+    uint32_t seed = cfg->dither_seed ? cfg->dither_seed : DITHER_SEED_DEFAULT;
+    if (seed != st->dith.seed)
+        dither_init(&st->dith, seed);
+    st->dith.mode = cfg->dither_mode;
+
+    if (st->fixed)
+        return dsp_fixed_process_block(&st->fx, cfg, &st->dyn, &st->dith,
+                                       st->rs.step, in, out, n, stats);
+
+    if (stats)
+        *stats = (dsp_block_stats_t){ 0 };
+
+    dsp_kernel_t kernel = dsp_kernels[DSP_KEY(cfg->filter, cfg->compress,
+                                              cfg->saturate, cfg->shape,
+                                              cfg->dither)];
+    return kernel(st, in, out, n, stats);
+}
+
+static void stats_add(dsp_block_stats_t *to, const dsp_block_stats_t *s)
+{
+    to->abs_sum += s->abs_sum;
+    if (s->abs_peak > to->abs_peak) to->abs_peak = s->abs_peak;
+    to->qerr_sum += s->qerr_sum;
+    to->dc_sum += s->dc_sum;
+    to->clips += s->clips;
+    to->os_ns += s->os_ns;
+    to->samples += s->samples;
+}
+
+// --------------------------------------------------
+// Source decimation
+//
+// A chunk of input (after what was held back) is decimated to in_rate
+// and run through the chain; samples short of a whole output sample wait
+// for the next block, so any block size works.
+// --------------------------------------------------
+#define DEC_CHUNK HB_BLOCK      // chain samples per pass
+
+int dsp_process_block(dsp_state_t *st, const dsp_config_t *cfg,
+                      const float *in, uint8_t *out, int n,
+                      dsp_block_stats_t *stats)
+{
+    const int f = st->dec.factor;
+    if (f == 1)
+        return chain_process(st, cfg, in, out, n, stats);
+
+    float hi[DSP_OVERSAMPLE_MAX * DEC_CHUNK], lo[DEC_CHUNK];
+    dsp_block_stats_t part;
+    int produced = 0;
+
+    if (stats)
+        *stats = (dsp_block_stats_t){ 0 };
+
+    for (int i = 0; i < n; ) {
+        int k = st->dec_held;
+        memcpy(hi, st->dec_hold, k * sizeof(float));
+        int take = n - i < f * DEC_CHUNK - k ? n - i : f * DEC_CHUNK - k;
+        memcpy(hi + k, in + i, take * sizeof(float));
+        i += take;
+        k += take;
+
+        int m = k / f;
+        st->dec_held = k - m * f;
+        memcpy(st->dec_hold, hi + m * f, st->dec_held * sizeof(float));
+        if (!m)
+            continue;
+
+        dsp_oversample_down(&st->dec, hi, lo, m);
+        produced += chain_process(st, cfg, lo, out + produced, m,
+                                  stats ? &part : NULL);
+        if (stats)
+            stats_add(stats, &part);
+    }
+    return produced;
+}
@@ -3,57 +3,258 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "dither.h"
 
-#define FIR_TAPS 57
-#define POST_FIR_TAPS 57
+// Pre-FIR: Kaiser-windowed sinc designed at run time for the input and
+// target rates. Spec: down FIR_STOP_DB from the target's Nyquist (or the
+// input's, if lower) up, passband to FIR_PASS_FRAC of that edge. The tap
+// count is the fewest that meet it, in steps of 8 (8k + 1 taps for the
+// symmetric kernel); at 48 kHz in, 28.15 kHz out that is 57.
+#define FIR_STOP_DB     60.0
+#define FIR_PASS_FRAC   0.75
+#define FIR_TAPS_MAX    257     // meets the spec down to ~5.5 kHz out
+#define FIR_DESIGNS     4       // (input, target) designs kept per pipeline
+
+// Polyphase resampler: RS_TAPS taps per phase, RS_PHASES sub-sample
+// phases (linearly interpolated between neighbouring phases)
+#define RS_TAPS     32
+#define RS_PHASES   64
+#define RS_CUTOFF_HZ 14000.0f   // at most; lower targets get the pre-FIR's
 
 typedef struct {
     float prev_in;
     float prev_out;
 } dcblock_t;
 
+// Linear (double-length) history: every sample is written twice, so
+// hist[pos .. pos+taps-1] is always the newest-first window, no wrap.
 typedef struct {
-    float hist[FIR_TAPS];
+    float coef[FIR_TAPS_MAX];   // symmetric, first taps used
+    float hist[2 * FIR_TAPS_MAX];
+    int taps;
     int pos;
 } fir_t;
 
+// Fractional resampler, replaces post-FIR + drop-sample decimation.
+// Output is only computed at output instants, at the exact sub-sample
+// phase: windowed-sinc LPF when filtering, linear interpolation when not.
 typedef struct {
-    float hist[POST_FIR_TAPS];
+    float table[RS_PHASES + 1][RS_TAPS];
+    float hist[2 * RS_TAPS];
     int pos;
-} postfir_t;
+    double t;               // next output time rel. to newest input (samples)
+    double step;            // in_rate / out_rate
+} resampler_t;
+
+// Compressor defaults, used where dsp_config_t leaves a field at 0. The
+// time constants give the old fixed per-sample poles (0.95 / 0.9999) at
+// 48 kHz; the ratio is the old 0.33 slope.
+#define DSP_COMP_THRESHOLD_DEFAULT  0.7f
+#define DSP_COMP_RATIO_DEFAULT      3.03f
+#define DSP_COMP_ATTACK_MS_DEFAULT  0.406f
+#define DSP_COMP_RELEASE_MS_DEFAULT 208.3f
+
+// Compressor coefficients at the input rate, from dsp_config_t
+typedef struct {
+    float att, att_in;      // envelope pole and 1 - pole, rising
+    float rel, rel_in;      // ...falling
+    float threshold;
+    float slope;            // 1 / ratio
+    float knee;             // threshold * (1 - slope)
+    float key[5];           // threshold, ratio, attack, release, rate
+} dsp_dynamics_t;
+
+// 2x/4x oversampling around the compressor and saturator, so their
+// harmonics are filtered instead of aliasing back down. Each 2x step is a
+// polyphase halfband FIR: every other tap is zero and the centre tap is
+// 1/2, so only the HB_TAPS_* odd-offset taps are stored and multiplied,
+// once per low-rate sample each way. 4x adds a short second stage at
+// 2x, where the transition band is wide.
+#define HB_TAPS_1 24        // 48k <-> 96k, ~61 dB stopband past 28 kHz
+#define HB_TAPS_2 8         // 96k <-> 192k
+#define DSP_OVERSAMPLE_MAX 4
+
+// Histories hold the last taps - 1 samples, oldest first
+typedef struct {
+    float coef[HB_TAPS_1];      // odd-offset taps, symmetric, sum 1/2
+    float up[HB_TAPS_1 - 1];    // interpolator input
+    float tap[HB_TAPS_1 - 1];   // decimator: phase through the taps
+    float mid[HB_TAPS_1 - 1];   // ...phase through the centre tap
+} halfband_t;
+
+typedef struct {
+    halfband_t hb[2];       // 2x, then 2x again for 4x
+    int factor;             // 1, 2 or 4
+} oversampler_t;
+
+// Sources above 48 kHz (88.2/96, 176.4/192) go down to 44.1/48 kHz
+// through the same halfband decimators before the chain, so the pre-FIR,
+// compressor and quantizer always run at the base rate.
+#define DSP_BASE_RATE_MAX 48000.0f
 
 typedef struct {
     float e1, e2, e3;       // oversample quantizer errors
     float e1_out, e2_out;   // final quantizer errors
-    float dither_hp;        // HP dither state
     float comp_env;         // compressor env follower
 } nshaper_t;
 
+// Integer mirror of the chain for FPU-poor Pis (dsp_fixed.c): Q27
+// samples, Q30 filter taps, Q32 resampler time
+typedef struct {
+    int32_t dc_in, dc_out;
+    int32_t fir_taps[FIR_TAPS_MAX];
+    int32_t fir[2 * FIR_TAPS_MAX];
+    int fir_n, fir_pos;
+    int32_t rs_table[RS_PHASES + 1][RS_TAPS];
+    int32_t rs_hist[2 * RS_TAPS];
+    int rs_pos;
+    int64_t rs_t;
+    int32_t e1, e2, e3;
+    int32_t e1_out, e2_out;
+    int32_t comp_env;
+    int32_t comp_att, comp_att_in;  // envelope poles, Q27
+    int32_t comp_rel, comp_rel_in;
+    int32_t comp_th, comp_slope;    // what comp_gain[] was built for
+    int32_t qtab[256];          // q/127 in Q27, q = -128..127
+    int32_t comp_gain[257];     // compressor gain vs envelope above threshold
+} dsp_fixed_t;
+
+// Which path dsp_state_init selects; build with -DDSP_FIXED_DEFAULT=1
+// for the integer one, or pick per run (--fixed / --float)
+#ifndef DSP_FIXED_DEFAULT
+#define DSP_FIXED_DEFAULT 0
+#endif
+
 typedef struct {
     bool filter;       // pre-FIR + post-FIR
     bool shape;        // enable noise shaping in both quantizers
-    bool dither;       // HP-TPDF in oversample quantizer
+    bool dither;       // TPDF in oversample quantizer
     bool compress;
     bool saturate;
     float gain;
     float target_rate;
+
+    // compressor, 0 = DSP_COMP_*_DEFAULT
+    float comp_threshold;   // envelope level where gain reduction starts
+    float comp_ratio;       // N:1 above the threshold
+    float comp_attack_ms;   // envelope time constants
+    float comp_release_ms;
+
+    // factor the compressor and saturator run at: 1, 2 or 4 (0 = 1).
+    // Float path only; the fixed-point path always runs them at 1x.
+    int oversample;
+
+    int dither_mode;        // DITHER_* spectrum, 0 = HP
+    uint32_t dither_seed;   // 0 = DITHER_SEED_DEFAULT; a change restarts it
 } dsp_config_t;
 
-void dsp_init(dcblock_t *dc, fir_t *fir, postfir_t *postfir, nshaper_t *ns);
+// Pre-FIR taps and resampler table for one rate pair
+typedef struct {
+    float in_rate, out_rate;    // 0 = slot unused
+    int taps;
+    float fir[FIR_TAPS_MAX];
+    float rs[RS_PHASES + 1][RS_TAPS];
+} dsp_filters_t;
+
+// Complete state of one DSP pipeline (block engine)
+typedef struct {
+    dcblock_t dc;
+    fir_t fir;
+    resampler_t rs;
+    nshaper_t ns;
+    dsp_dynamics_t dyn;     // compressor coefficients for the current config
+    dsp_filters_t designs[FIR_DESIGNS];     // recent rate pairs, any order
+    int design_cur;         // the one fir and rs hold
+    int design_next;        // slot a new pair replaces
+    oversampler_t os;       // around the compressor and saturator
+    dither_t dith;          // this pipeline's dither, shared by both paths
+    float in_rate;          // the chain's rate: src_rate / dec.factor
+    float src_rate;         // rate of the samples dsp_process_block gets
+    oversampler_t dec;      // src_rate -> in_rate (factor 1 = none)
+    float dec_hold[DSP_OVERSAMPLE_MAX - 1];    // short of an output sample
+    int dec_held;
+    float drift_ppm;        // resampling ratio trim (drift loop), + = slower
+    bool fixed;             // run the integer path (dsp_fixed.c)
+    dsp_fixed_t fx;
+} dsp_state_t;
+
+// Per-block aggregates for the UI meters
+typedef struct {
+    float abs_sum;          // sum of |x| into the oversample quantizer
+    float abs_peak;         // max |x| into the oversample quantizer
+    float qerr_sum;         // sum of |oversample quantizer error|
+    float dc_sum;           // sum of x into the oversample quantizer
+    int clips;              // samples at or above the clip threshold
+    uint64_t os_ns;         // time spent in the oversampled section
+    int samples;            // into the oversample quantizer, at in_rate
+} dsp_block_stats_t;
+
+void dsp_init(dcblock_t *dc, fir_t *fir, nshaper_t *ns);
 
 float dsp_dcblock(dcblock_t *st, float x);
 float dsp_fir(fir_t *st, float x);
-float dsp_postfir(postfir_t *st, float x);
 
-float dsp_compress(nshaper_t *st, float x);
-float dsp_saturate(float x);
+// Pre-FIR for in_rate -> out_rate: taps into coef, returns the count
+int dsp_fir_design(float *coef, float in_rate, float out_rate);
+// and its -6 dB point, which the resampler's cutoff follows
+float dsp_fir_cutoff(float in_rate, float out_rate);
+// largest stopband gain (dB) of n taps over out_rate's stopband
+double dsp_fir_stopband_db(const float *coef, int n, float in_rate, float out_rate);
+
+void dsp_resampler_init(resampler_t *rs, float in_rate, float cutoff_hz);
+void dsp_resampler_set_rate(resampler_t *rs, float in_rate, float out_rate);
+// push one input sample; returns 1 and writes *y at each output instant
+int dsp_resample(resampler_t *rs, float x, bool filter, float *y);
 
-// oversample quantizer: runs at 48k, float output (filtered -> decimated)
+// Resolve cfg's compressor fields (0 = default) at rate; a no-op when
+// nothing changed since the last call
+void dsp_dynamics_set(dsp_dynamics_t *dyn, const dsp_config_t *cfg, float rate);
+
+// Block stages, in place. The compressor's envelope is serial but
+// branch-free; its gain, min(1, slope + knee / env), and the saturator
+// are pure maps that vectorise.
+void dsp_compress_block(nshaper_t *st, const dsp_dynamics_t *dyn, float *x, int n);
+void dsp_saturate_block(float *x, int n);
+
+// Clear the halfband histories and switch to factor (1, 2 or 4)
+void dsp_oversampler_reset(oversampler_t *os, int factor);
+// n samples at the input rate to factor * n at the oversampled rate, and
+// back. A round trip delays by HB_TAPS_1 - 1 input samples at 2x, 3.5
+// more at 4x.
+void dsp_oversample_up(oversampler_t *os, const float *x, float *hi, int n);
+void dsp_oversample_down(oversampler_t *os, const float *hi, float *x, int n);
+
+// oversample quantizer: runs at 48k, float output (-> resampler).
+// dither is one dither_block() sample, 0 for none.
 float dsp_quantize_oversample(nshaper_t *st, float x,
-                              bool shape, bool dither);
+                              bool shape, float dither);
 
 // final 8-bit quantizer at target_rate
 uint8_t dsp_quantize_final(nshaper_t *st, float x, bool shape);
 
+// --------------------------------------------------
+// Block engine
+// --------------------------------------------------
+// src_rate: the rate blocks will arrive at (see dsp_set_src_rate)
+void dsp_state_init(dsp_state_t *st, float src_rate);
+
+// A new source rate: picks the decimation (1, 2 or 4) that brings it to
+// DSP_BASE_RATE_MAX or below and clears its history. The filters and the
+// compressor follow the new in_rate from the next block.
+void dsp_set_src_rate(dsp_state_t *st, float src_rate);
+
+// Switch the pre-FIR and resampler filter to in_rate -> out_rate, from the
+// state's cache or a new design (which evicts the oldest). A no-op when
+// they already match; the FIR history is cleared when the length changes.
+void dsp_filters_set(dsp_state_t *st, float in_rate, float out_rate);
+
+// Runs n input samples (at src_rate) through the whole chain and
+// resamples to cfg->target_rate (<= in_rate). out must hold n bytes;
+// returns bytes written.
+// stats may be NULL.
+int dsp_process_block(dsp_state_t *st, const dsp_config_t *cfg,
+                      const float *in, uint8_t *out, int n,
+                      dsp_block_stats_t *stats);
+
 #endif
 
@@ -0,0 +1,348 @@
+#include "dsp_fixed.h"
+#include <math.h>
+#include <string.h>
+
+// Q27 constant
+#define FXC(c) ((int32_t)((c) * (double)FX_ONE + ((c) >= 0 ? 0.5 : -0.5)))
+
+#define FX_TAP_FRAC  30
+
+// compressor gain table: threshold .. threshold + 2.0
+#define FX_COMP_SEG_BITS  (FX_FRAC - 7)     // table step 1/128 of full scale
+#define FX_COMP_SEGS      256               // covers th .. th + 2.0
+
+static inline int32_t fx_mul(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b + (1 << (FX_FRAC - 1))) >> FX_FRAC);
+}
+
+static inline int32_t fx_abs(int32_t x)
+{
+    return x < 0 ? -x : x;
+}
+
+static inline int32_t fx_tap(double c)
+{
+    return (int32_t)lrint(c * (double)(1 << FX_TAP_FRAC));
+}
+
+// roundf(x * 127), half away from zero
+static inline int fx_round127(int32_t x)
+{
+    int64_t v = (int64_t)x * 127;
+    int64_t half = (int64_t)1 << (FX_FRAC - 1);
+    return v >= 0 ? (int)((v + half) >> FX_FRAC) : -(int)((-v + half) >> FX_FRAC);
+}
+
+void dsp_fixed_set_filters(dsp_fixed_t *fx, const fir_t *fir, const resampler_t *rs)
+{
+    if (fir->taps != fx->fir_n) {
+        memset(fx->fir, 0, sizeof(fx->fir));
+        fx->fir_n = fir->taps;
+        fx->fir_pos = 0;
+    }
+    for (int t = 0; t < fir->taps; t++)
+        fx->fir_taps[t] = fx_tap(fir->coef[t]);
+    for (int p = 0; p <= RS_PHASES; p++)
+        for (int k = 0; k < RS_TAPS; k++)
+            fx->rs_table[p][k] = fx_tap(rs->table[p][k]);
+}
+
+void dsp_fixed_init(dsp_fixed_t *fx, const fir_t *fir, const resampler_t *rs)
+{
+    memset(fx, 0, sizeof(*fx));
+    dsp_fixed_set_filters(fx, fir, rs);
+
+    for (int q = -128; q < 128; q++)
+        fx->qtab[q + 128] = (int32_t)lrint(q * (double)FX_ONE / 127.0);
+}
+
+// --------------------------------------------------
+// DC Block
+// --------------------------------------------------
+int32_t dsp_fx_dcblock(dsp_fixed_t *fx, int32_t x)
+{
+    int32_t y = x - fx->dc_in + fx_mul(FXC(0.995), fx->dc_out);
+    fx->dc_in = x;
+    fx->dc_out = y;
+    return y;
+}
+
+// --------------------------------------------------
+// Pre-FIR (symmetric, pairs folded as in dsp.c)
+// --------------------------------------------------
+int32_t dsp_fx_fir(dsp_fixed_t *fx, int32_t x)
+{
+    const int n = fx->fir_n;
+    if (--fx->fir_pos < 0) fx->fir_pos = n - 1;
+    fx->fir[fx->fir_pos] = x;
+    fx->fir[fx->fir_pos + n] = x;
+
+    const int32_t *w = &fx->fir[fx->fir_pos];
+    const int32_t *c = fx->fir_taps;
+    int64_t acc = (int64_t)c[n / 2] * w[n / 2];
+    for (int t = 0; t < n / 2; t++)
+        acc += (int64_t)c[t] * (w[t] + w[n - 1 - t]);
+
+    return (int32_t)((acc + (1 << (FX_TAP_FRAC - 1))) >> FX_TAP_FRAC);
+}
+
+// --------------------------------------------------
+// Polyphase resampler
+// --------------------------------------------------
+static inline int32_t fx_dot(const int32_t *c, const int32_t *w)
+{
+    int64_t acc = 0;
+    for (int k = 0; k < RS_TAPS; k++)
+        acc += (int64_t)c[k] * w[k];
+    return (int32_t)((acc + (1 << (FX_TAP_FRAC - 1))) >> FX_TAP_FRAC);
+}
+
+int dsp_fx_resample(dsp_fixed_t *fx, int64_t step_q32, int32_t x, bool filter, int32_t *y)
+{
+    if (--fx->rs_pos < 0) fx->rs_pos = RS_TAPS - 1;
+    fx->rs_hist[fx->rs_pos] = x;
+    fx->rs_hist[fx->rs_pos + RS_TAPS] = x;
+
+    fx->rs_t -= (int64_t)1 << 32;
+    if (fx->rs_t > 0)
+        return 0;
+
+    // output instant lies d (Q32, 0..1] samples before the newest input
+    int64_t d = -fx->rs_t;
+    fx->rs_t += step_q32;
+
+    const int32_t *w = &fx->rs_hist[fx->rs_pos];
+
+    if (!filter) {
+        *y = w[0] + (int32_t)(((int64_t)(w[1] - w[0]) * (d >> 16)) >> 16);
+        return 1;
+    }
+
+    int64_t dp = d * RS_PHASES;
+    int p = (int)(dp >> 32);
+    if (p >= RS_PHASES) p = RS_PHASES - 1;
+    int64_t frac = (dp - ((int64_t)p << 32)) >> 16;    // Q16, 0..1
+
+    int32_t y0 = fx_dot(fx->rs_table[p], w);
+    int32_t y1 = fx_dot(fx->rs_table[p + 1], w);
+    *y = y0 + (int32_t)(((int64_t)(y1 - y0) * frac) >> 16);
+    return 1;
+}
+
+// --------------------------------------------------
+// Compressor
+// --------------------------------------------------
+static inline int32_t fx_from_double(double c)
+{
+    return (int32_t)lrint(c * (double)FX_ONE);
+}
+
+void dsp_fixed_set_dynamics(dsp_fixed_t *fx, const dsp_dynamics_t *dyn)
+{
+    fx->comp_att = fx_from_double(dyn->att);
+    fx->comp_att_in = fx_from_double(dyn->att_in);
+    fx->comp_rel = fx_from_double(dyn->rel);
+    fx->comp_rel_in = fx_from_double(dyn->rel_in);
+
+    int32_t th = fx_from_double(dyn->threshold);
+    int32_t slope = fx_from_double(dyn->slope);
+    if (th == fx->comp_th && slope == fx->comp_slope)
+        return;
+    fx->comp_th = th;
+    fx->comp_slope = slope;
+
+    for (int i = 0; i <= FX_COMP_SEGS; i++) {
+        double env = dyn->threshold + i / 128.0;
+        fx->comp_gain[i] = fx_from_double((dyn->threshold + (env - dyn->threshold) *
+                                           dyn->slope) / env);
+    }
+}
+
+int32_t dsp_fx_compress(dsp_fixed_t *fx, int32_t x)
+{
+    int32_t env = fx_abs(x);
+    if (env > fx->comp_env)
+        fx->comp_env = fx_mul(fx->comp_env, fx->comp_att) + fx_mul(env, fx->comp_att_in);
+    else
+        fx->comp_env = fx_mul(fx->comp_env, fx->comp_rel) + fx_mul(env, fx->comp_rel_in);
+
+    if (fx->comp_env <= fx->comp_th)
+        return x;
+
+    // (th + over * slope) / env, interpolated; exact divide past the table
+    int32_t over = fx->comp_env - fx->comp_th;
+    int i = over >> FX_COMP_SEG_BITS;
+    int32_t gain;
+    if (i < FX_COMP_SEGS) {
+        int32_t f = over & ((1 << FX_COMP_SEG_BITS) - 1);
+        int32_t g0 = fx->comp_gain[i], g1 = fx->comp_gain[i + 1];
+        gain = g0 + (int32_t)(((int64_t)(g1 - g0) * f) >> FX_COMP_SEG_BITS);
+    } else {
+        int64_t num = fx->comp_th + fx_mul(over, fx->comp_slope);
+        gain = (int32_t)((num << FX_FRAC) / fx->comp_env);
+    }
+    return fx_mul(x, gain);
+}
+
+// --------------------------------------------------
+// Soft Saturator
+// --------------------------------------------------
+int32_t dsp_fx_saturate(int32_t x)
+{
+    int32_t ax = fx_abs(x);
+    if (ax < FXC(0.8)) return x;
+    if (ax > FXC(1.5)) return x > 0 ? FX_ONE : -FX_ONE;
+
+    int32_t t = fx_mul(ax - FXC(0.8), FXC(1.0 / 0.7));
+    int32_t u = FX_ONE - t;
+    int32_t s = FXC(0.8) + fx_mul(FXC(0.2), FX_ONE - fx_mul(u, u));
+    return x > 0 ? s : -s;
+}
+
+// --------------------------------------------------
+// Oversample Quantizer (48k)
+// --------------------------------------------------
+int32_t dsp_fx_quantize_oversample(dsp_fixed_t *fx, int32_t x, bool shape, int32_t dither)
+{
+    int32_t shaped = x;
+
+    if (shape)
+        shaped = x + fx_mul(FXC(1.8), fx->e1) - fx_mul(FXC(1.1), fx->e2)
+                   + fx_mul(FXC(0.3), fx->e3);
+
+    shaped += dither >> 9;                      // * 0.5/256
+
+    if (shaped > FXC(0.98)) shaped = FXC(0.98);
+    if (shaped < -FXC(0.98)) shaped = -FXC(0.98);
+
+    int32_t quantized = fx->qtab[fx_round127(shaped) + 128];
+
+    if (shape) {
+        fx->e3 = fx->e2;
+        fx->e2 = fx->e1;
+        fx->e1 = shaped - quantized;
+    } else {
+        fx->e1 = fx->e2 = fx->e3 = 0;
+    }
+
+    return quantized;
+}
+
+// --------------------------------------------------
+// Final Quantizer (8-bit @ target_rate)
+// --------------------------------------------------
+uint8_t dsp_fx_quantize_final(dsp_fixed_t *fx, int32_t x, bool shape)
+{
+    int32_t shaped = x;
+    if (shape)
+        shaped = x + fx_mul(FXC(0.5), fx->e1_out) - fx_mul(FXC(0.1), fx->e2_out);
+
+    if (shaped > FXC(0.98)) shaped = FXC(0.98);
+    if (shaped < -FXC(0.98)) shaped = -FXC(0.98);
+
+    int q = fx_round127(shaped);
+
+    if (shape) {
+        fx->e2_out = fx->e1_out;
+        fx->e1_out = shaped - fx->qtab[q + 128];
+    } else {
+        fx->e1_out = fx->e2_out = 0;
+    }
+
+    q += 128;
+    if (q < 0) q = 0;
+    if (q > 255) q = 255;
+    return (uint8_t)q;
+}
+
+// --------------------------------------------------
+// Block statistics, integer sums converted once per chunk
+// --------------------------------------------------
+#define FX_STATS_CHUNK 256
+#define FX_CLIP_LEVEL  FXC(0.99)        // DSP_CLIP_LEVEL in dsp.c
+
+static void fx_block_reduce(const int32_t *x, const int32_t *q, int n,
+                            dsp_block_stats_t *st)
+{
+    int64_t abs_sum = 0, qerr_sum = 0, dc_sum = 0;
+    int32_t abs_peak = 0;
+    int clips = 0;
+
+    for (int i = 0; i < n; i++) {
+        int32_t ax = fx_abs(x[i]);
+        abs_sum += ax;
+        if (ax > abs_peak) abs_peak = ax;
+        clips += ax >= FX_CLIP_LEVEL;
+        qerr_sum += fx_abs(x[i] - q[i]);
+        dc_sum += x[i];
+    }
+
+    const float scale = 1.0f / (float)FX_ONE;
+    st->abs_sum += (float)abs_sum * scale;
+    if ((float)abs_peak * scale > st->abs_peak) st->abs_peak = (float)abs_peak * scale;
+    st->qerr_sum += (float)qerr_sum * scale;
+    st->dc_sum += (float)dc_sum * scale;
+    st->clips += clips;
+    st->samples += n;
+}
+
+// --------------------------------------------------
+// Block engine
+// --------------------------------------------------
+int dsp_fixed_process_block(dsp_fixed_t *fx, const dsp_config_t *cfg,
+                            const dsp_dynamics_t *dyn, dither_t *dith,
+                            double step, const float *in, uint8_t *out,
+                            int n, dsp_block_stats_t *stats)
+{
+    const bool filter   = cfg->filter;
+    const bool compress = cfg->compress;
+    const bool saturate = cfg->saturate;
+    const bool shape    = cfg->shape;
+    const bool dither   = cfg->dither;
+    const int64_t step_q32 = (int64_t)(step * 4294967296.0);
+
+    if (compress)
+        dsp_fixed_set_dynamics(fx, dyn);
+
+    if (stats)
+        *stats = (dsp_block_stats_t){ 0 };
+
+    int32_t xs[FX_STATS_CHUNK], qs[FX_STATS_CHUNK];
+    float ds[FX_STATS_CHUNK];
+    int produced = 0;
+
+    for (int base = 0; base < n; base += FX_STATS_CHUNK) {
+        int m = n - base < FX_STATS_CHUNK ? n - base : FX_STATS_CHUNK;
+
+        // the same sequence as the float path would add
+        if (dither)
+            dither_block(dith, ds, m);
+
+        for (int i = 0; i < m; i++) {
+            int32_t x = dsp_fx_dcblock(fx, dsp_fx_from_float(in[base + i]));
+
+            if (filter)
+                x = dsp_fx_fir(fx, x);
+
+            if (compress)
+                x = dsp_fx_compress(fx, x);
+
+            if (saturate)
+                x = dsp_fx_saturate(x);
+
+            int32_t d = dither ? dsp_fx_from_float(ds[i]) : 0;
+            int32_t q_over = dsp_fx_quantize_oversample(fx, x, shape, d);
+            xs[i] = x;
+            qs[i] = q_over;
+
+            int32_t qf;
+            if (dsp_fx_resample(fx, step_q32, q_over, filter, &qf))
+                out[produced++] = dsp_fx_quantize_final(fx, qf, shape);
+        }
+
+        if (stats)
+            fx_block_reduce(xs, qs, m, stats);
+    }
+    return produced;
+}
@@ -0,0 +1,125 @@
+// Block compressor and saturator against the per-sample forms they
+// replaced. With default parameters at 48 kHz the compressor must follow
+// the old fixed curve (0.95 / 0.9999 poles, 0.7 threshold, 0.33 slope) to
+// within COMP_BOUND of full scale, for any block split, over level steps
+// and noise bursts that work both the attack and the release. The
+// saturator must be bit-identical to the old three-branch form.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+
+#define T_RATE      48000.0f
+#define T_N         (10 * 48000)
+#define COMP_BOUND  2e-4        // the README's figure, ~1/40 of an 8-bit LSB
+
+static float in[T_N], ref[T_N], blk[T_N];
+
+// the pre-block per-sample compressor
+static float compress_ref(float *env, float x)
+{
+    float ax = fabsf(x);
+    if (ax > *env)
+        *env = *env * 0.95f + ax * 0.05f;
+    else
+        *env = *env * 0.9999f + ax * 0.0001f;
+
+    float th = 0.7f;
+    if (*env > th) {
+        float over = *env - th;
+        float gain = (th + over * 0.33f) / *env;
+        x *= gain;
+    }
+    return x;
+}
+
+// the pre-block per-sample saturator
+static float saturate_ref(float x)
+{
+    float ax = fabsf(x);
+    if (ax < 0.8f) return x;
+    if (ax > 1.5f) return (x > 0) ? 1.0f : -1.0f;
+
+    float t = (ax - 0.8f) / 0.7f;
+    float s = 0.8f + 0.2f * (1.0f - (1.0f - t) * (1.0f - t));
+    return (x > 0 ? s : -s);
+}
+
+// 440 Hz at a level that steps every half second, with a noise burst
+// over the top every other step
+static void make_signal(void)
+{
+    static const float steps[] = { 0.2f, 0.9f, 0.5f, 1.0f, 0.1f, 0.8f, 0.3f, 1.4f };
+    uint32_t r = 0x9E3779B9;
+    for (int i = 0; i < T_N; i++) {
+        int k = i / (int)(T_RATE / 2);
+        float x = steps[k % 8] * (float)sin(2.0 * M_PI * 440.0 * i / T_RATE);
+        if (k & 1) {
+            r = r * 1664525u + 1013904223u;
+            x += 0.3f * ((float)(r >> 8) / 8388608.0f - 1.0f);
+        }
+        in[i] = x;
+    }
+}
+
+static int check(const char *what, bool ok)
+{
+    printf("dynamics_test %-44s: %s\n", what, ok ? "OK" : "FAIL");
+    return !ok;
+}
+
+static double compress_err(int block)
+{
+    dsp_dynamics_t dyn;
+    memset(&dyn, 0, sizeof(dyn));
+    dsp_dynamics_set(&dyn, &(dsp_config_t){ 0 }, T_RATE);
+
+    nshaper_t st = { 0 };
+    memcpy(blk, in, sizeof(blk));
+    for (int i = 0, m = block; i < T_N; i += m, m = block ? block : m % 300 + 1)
+        dsp_compress_block(&st, &dyn, blk + i, i + m < T_N ? m : T_N - i);
+
+    double err = 0.0;
+    for (int i = 0; i < T_N; i++) {
+        double e = fabs((double)blk[i] - ref[i]);
+        if (e > err) err = e;
+    }
+    return err;
+}
+
+int main(void)
+{
+    int fail = 0;
+    char what[64];
+
+    make_signal();
+    float env = 0.0f;
+    for (int i = 0; i < T_N; i++)
+        ref[i] = compress_ref(&env, in[i]);
+
+    static const int blocks[] = { 256, 1, 0 };     // 0: odd sizes
+    for (unsigned b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+        double err = compress_err(blocks[b]);
+        if (blocks[b])
+            snprintf(what, sizeof(what), "compress, %d-sample blocks: max err %.2e",
+                     blocks[b], err);
+        else
+            snprintf(what, sizeof(what), "compress, odd blocks: max err %.2e", err);
+        fail |= check(what, err <= COMP_BOUND);
+    }
+
+    // every float from 0.5 to 2 (the knee, the curve and the clip), and
+    // a grid below it; both signs
+    int diff = 0;
+    for (float a = 0.0f; a <= 2.0f; a = a < 0.5f ? a + 1e-5f : nextafterf(a, 3.0f)) {
+        float y[2] = { a, -a };
+        dsp_saturate_block(y, 2);
+        float want[2] = { saturate_ref(a), saturate_ref(-a) };
+        diff += memcmp(y, want, sizeof(y)) != 0;
+    }
+    snprintf(what, sizeof(what), "saturate, -2..2: %d values differ", diff);
+    fail |= check(what, diff == 0);
+
+    return fail;
+}
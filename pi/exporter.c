@@ -0,0 +1,235 @@
+#include "exporter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+static inline uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000ULL) + ts.tv_nsec / 1000000ULL;
+}
+
+#define LOAD(p) atomic_load_explicit(p, memory_order_relaxed)
+
+// Numbers kept per instance between intervals (exporter thread only)
+typedef struct {
+    audio_metrics_t m;
+    pico_view_t pico;
+    float spi_bytes_ps;
+    unsigned long last_bytes;
+} inst_view_t;
+
+static void header(FILE *f, const char *name, const char *type, const char *help)
+{
+    fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Label values per the text format: backslash, quote and newline escaped.
+// dst must hold 2 * strlen(src) + 1.
+static void label_escape(char *dst, const char *src)
+{
+    for (; *src; src++) {
+        if (*src == '\\' || *src == '"') {
+            *dst++ = '\\';
+            *dst++ = *src;
+        } else if (*src == '\n') {
+            *dst++ = '\\';
+            *dst++ = 'n';
+        } else {
+            *dst++ = *src;
+        }
+    }
+    *dst = 0;
+}
+
+// one metric for the first instance (recorder), with its header
+static void metric(FILE *f, const char *name, const char *type,
+                   const char *help, const char *pipeline, double v)
+{
+    header(f, name, type, help);
+    fprintf(f, "%s{pipeline=\"%s\"} %.9g\n", name, pipeline, v);
+}
+
+// one header, then a sample per instance where cond holds; in and v are
+// the instance and its view inside cond and value, label[] the escaped names
+#define PER_INSTANCE(mname, type, help, cond, value) do {                   \
+        header(f, mname, type, help);                                       \
+        for (int i_ = 0; i_ < ea->n_inst; i_++) {                           \
+            const instance_t *in = &ea->inst[i_];                           \
+            const inst_view_t *v = &views[i_];                              \
+            (void)in; (void)v;                                              \
+            if (cond)                                                       \
+                fprintf(f, "%s{pipeline=\"%s\"} %.9g\n", mname, label[i_],  \
+                        (double)(value));                                   \
+        }                                                                   \
+    } while (0)
+
+#define ALL true
+#define CAPTURE (instance_capture_stats(in) != NULL)
+#define PICO    (in->pico.tty != NULL && v->pico.last_ms != 0)
+
+static void write_metrics(FILE *f, const exporter_args_t *ea,
+                          const inst_view_t *views)
+{
+    char label[INSTANCE_MAX][2 * sizeof(ea->inst[0].name)];
+    for (int i = 0; i < ea->n_inst; i++)
+        label_escape(label[i], ea->inst[i].name);
+    uint64_t t = now_ms();
+
+    PER_INSTANCE("sampler_dsp_load", "gauge",
+                 "Audio thread DSP time / block duration, smoothed", ALL, v->m.dsp_load);
+    PER_INSTANCE("sampler_dsp_oversample_load", "gauge",
+                 "Part of sampler_dsp_load spent oversampling compress/saturate", ALL, v->m.os_load);
+    PER_INSTANCE("sampler_vu_level", "gauge",
+                 "Smoothed mean absolute level, 0..1", ALL, v->m.vu_level);
+    PER_INSTANCE("sampler_peak_level", "gauge",
+                 "Decaying peak level, 0..1", ALL, v->m.peak_level);
+    PER_INSTANCE("sampler_clips_total", "counter",
+                 "Samples at or above the clip threshold", ALL, v->m.clip_count);
+    PER_INSTANCE("sampler_quant_noise", "gauge",
+                 "Smoothed oversample quantiser error magnitude", ALL, v->m.quant_noise);
+    PER_INSTANCE("sampler_dc_offset", "gauge",
+                 "Smoothed DC offset into the quantiser", ALL, v->m.dc_offset);
+    PER_INSTANCE("sampler_ring_fill_bytes", "gauge",
+                 "Pi ring fill, mid-block", ALL, v->m.ring_fill);
+    PER_INSTANCE("sampler_drift_ppm", "gauge",
+                 "Clock drift correction applied to the resampler", ALL, v->m.drift_ppm);
+
+    PER_INSTANCE("sampler_spi_bytes_total", "counter",
+                 "Bytes sent to the Pico", ALL, LOAD(&in->spi_stats.bytes));
+    PER_INSTANCE("sampler_spi_bytes_per_second", "gauge",
+                 "SPI throughput over the last export interval", ALL, v->spi_bytes_ps);
+    PER_INSTANCE("sampler_spi_wakeups_total", "counter",
+                 "SPI sender wakeups", ALL, LOAD(&in->spi_stats.wakeups));
+    PER_INSTANCE("sampler_spi_syscalls_total", "counter",
+                 "SPI sender syscalls", ALL, LOAD(&in->spi_stats.syscalls));
+    PER_INSTANCE("sampler_spi_errors_total", "counter",
+                 "Failed SPI transfers", ALL, LOAD(&in->spi_stats.errors));
+    PER_INSTANCE("sampler_spi_error", "gauge",
+                 "errno of the last failed SPI transfer, 0 = none", ALL,
+                 LOAD(&in->spi_stats.error));
+
+    PER_INSTANCE("sampler_alsa_xruns_total", "counter",
+                 "ALSA capture overruns", CAPTURE, LOAD(&in->capture_stats.xruns));
+    PER_INSTANCE("sampler_alsa_suspends_total", "counter",
+                 "ALSA capture suspends", CAPTURE, LOAD(&in->capture_stats.suspends));
+    PER_INSTANCE("sampler_alsa_recoveries_total", "counter",
+                 "ALSA capture restarts after an xrun or suspend", CAPTURE,
+                 LOAD(&in->capture_stats.recoveries));
+    PER_INSTANCE("sampler_alsa_rate_hz", "gauge",
+                 "Capture rate negotiated with the device", CAPTURE,
+                 LOAD(&in->capture_stats.rate));
+    PER_INSTANCE("sampler_alsa_rate_changes_total", "counter",
+                 "Capture reopened for a new link rate (--alsa-rate auto)", CAPTURE,
+                 LOAD(&in->capture_stats.rate_changes));
+    PER_INSTANCE("sampler_alsa_error", "gauge",
+                 "Last fatal ALSA error (negative errno), 0 = ok", CAPTURE,
+                 LOAD(&in->capture_stats.error));
+
+    PER_INSTANCE("sampler_active", "gauge",
+                 "Pico activity pin (Amiga is sampling)", ALL, in->sampler_active);
+    PER_INSTANCE("sampler_active_transitions_total", "counter",
+                 "Edges on the Pico activity pin", ALL, LOAD(&in->ga.transitions));
+
+    PER_INSTANCE("sampler_pico_ring_fill_bytes", "gauge",
+                 "Pico ring fill from its last status line", PICO, v->pico.st.fill);
+    PER_INSTANCE("sampler_pico_strobe_hz", "gauge",
+                 "Amiga STROBE rate the Pico measured over its last second", PICO,
+                 v->pico.st.strobe_hz);
+    PER_INSTANCE("sampler_pico_underruns", "gauge",
+                 "Pico ring underruns in its last second", PICO, v->pico.st.underruns);
+    PER_INSTANCE("sampler_pico_pace_ppm", "gauge",
+                 "SPI pacing trim holding the Pico ring, + = slower", PICO, v->pico.pace_ppm);
+    PER_INSTANCE("sampler_pico_status_age_seconds", "gauge",
+                 "Time since the last Pico status line", PICO,
+                 t > v->pico.last_ms ? (t - v->pico.last_ms) / 1000.0 : 0.0);
+
+    const char *first = label[0];
+    if (ea->rec) {
+        metric(f, "sampler_record_passes_total", "counter",
+               "Sampling passes recorded", first, (double)LOAD(&ea->rec->passes));
+        metric(f, "sampler_record_raw_bytes_total", "counter",
+               "Stream bytes recorded, before encoding", first, (double)LOAD(&ea->rec->raw_bytes));
+        metric(f, "sampler_record_disk_bytes_total", "counter",
+               "Encoded bytes written", first, (double)LOAD(&ea->rec->disk_bytes));
+        metric(f, "sampler_record_dropped_bytes_total", "counter",
+               "Bytes lost to a full recorder queue", first, (double)LOAD(&ea->rec->dropped));
+        metric(f, "sampler_record_error", "gauge",
+               "Last recorder open/write errno, 0 = ok", first, LOAD(&ea->rec->error));
+    }
+
+    if (ea->lat) {
+        fprintf(f, "# HELP sampler_latency_us Per-stage latency, capture to SPI write\n"
+                   "# TYPE sampler_latency_us summary\n");
+        for (int s = 0; s < LAT_STAGES; s++) {
+            const lat_hist_t *h = &ea->lat->stage[s];
+            const char *st = lat_stage_name(s);
+            fprintf(f, "sampler_latency_us{pipeline=\"%s\",stage=\"%s\",quantile=\"0.5\"} %llu\n", first, st,
+                    (unsigned long long)lat_percentile_us(h, 0.50));
+            fprintf(f, "sampler_latency_us{pipeline=\"%s\",stage=\"%s\",quantile=\"0.99\"} %llu\n", first, st,
+                    (unsigned long long)lat_percentile_us(h, 0.99));
+            fprintf(f, "sampler_latency_us{pipeline=\"%s\",stage=\"%s\",quantile=\"1\"} %lu\n", first, st,
+                    LOAD(&h->max_us));
+            fprintf(f, "sampler_latency_us_count{pipeline=\"%s\",stage=\"%s\"} %lu\n", first, st,
+                    LOAD(&h->count));
+        }
+    }
+}
+
+// write to path.tmp, then rename: readers see the old or the new file
+static void export_once(const exporter_args_t *ea, const char *tmp,
+                        const inst_view_t *views)
+{
+    FILE *f = fopen(tmp, "w");
+    if (!f) return;
+
+    write_metrics(f, ea, views);
+    if (fclose(f) == 0)
+        rename(tmp, ea->path);
+}
+
+static void *exporter_thread(void *arg)
+{
+    exporter_args_t *ea = arg;
+    int interval = ea->interval_ms > 0 ? ea->interval_ms : EXPORTER_INTERVAL_MS_DEFAULT;
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ea->path);
+
+    inst_view_t views[INSTANCE_MAX] = { 0 };
+    uint64_t last_ms = now_ms();
+    for (int i = 0; i < ea->n_inst; i++)
+        views[i].last_bytes = LOAD(&ea->inst[i].spi_stats.bytes);
+
+    for (;;) {
+        usleep(interval * 1000);
+
+        uint64_t t = now_ms();
+        for (int i = 0; i < ea->n_inst; i++) {
+            inst_view_t *v = &views[i];
+
+            // a publish in flight just means we keep the previous copy
+            for (int k = 0; k < 4 && !metrics_fetch(&ea->inst[i].metrics, &v->m); k++)
+                ;
+            for (int k = 0; k < 4 && !pico_link_fetch(&ea->inst[i].pico, &v->pico); k++)
+                ;
+
+            unsigned long bytes = LOAD(&ea->inst[i].spi_stats.bytes);
+            v->spi_bytes_ps = t > last_ms ? (bytes - v->last_bytes) * 1000.0f / (t - last_ms)
+                                          : 0.0f;
+            v->last_bytes = bytes;
+        }
+        last_ms = t;
+
+        export_once(ea, tmp, views);
+    }
+    return NULL;
+}
+
+int exporter_thread_create(pthread_t *th, exporter_args_t *ea,
+                           const rt_thread_cfg_t *rt)
+{
+    return rt_thread_create(th, rt, "export", exporter_thread, ea);
+}
@@ -0,0 +1,39 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "instance.h"
+#include "latency.h"
+#include "rt.h"
+#include "recorder.h"
+
+// Prometheus text-format exporter for headless units. Every interval the
+// current numbers are written to a temp file and renamed over `path`, so
+// a scraper (node_exporter's textfile collector, or plain cat) never sees
+// a partial file. Put it on tmpfs, e.g. /run/sampler.prom.
+//
+// Every per-instance metric carries a pipeline="<name>" label; the
+// recorder and latency metrics belong to the first instance.
+//
+// Everything is read the same way the UI reads it: the meters through
+// their seqlock snapshot, counters as relaxed atomics. Nothing here can
+// block the audio thread.
+
+#define EXPORTER_INTERVAL_MS_DEFAULT 1000
+
+typedef struct {
+    const char *path;
+    int interval_ms;
+
+    const instance_t *inst;                 // meters, SPI/ALSA/GPIO counters
+    int n_inst;
+    const lat_trace_t *lat;                 // NULL unless --latency-trace
+    const recorder_t *rec;                  // NULL unless --record-dir
+} exporter_args_t;
+
+int exporter_thread_create(pthread_t *th, exporter_args_t *ea,
+                           const rt_thread_cfg_t *rt);
+
+#endif
@@ -3,20 +3,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <spawn.h>
 #include <sys/wait.h>
 #include <gpiod.h>
 
 static const char *SCRIPT_ACTIVE   = "./sampler_active.sh";
 static const char *SCRIPT_INACTIVE = "./sampler_inactive.sh";
 
-static void run_script(const char *path) {
+extern char **environ;
+
+// posix_spawn rather than fork(): no copy-on-write faults in the RT
+// threads while the child starts up
+static void run_script(const char *path, const char *name) {
     if (access(path, X_OK) != 0) return;
 
-    pid_t pid = fork();
-    if (pid == 0) {
-        execl(path, path, NULL);
-        _exit(127);
-    }
+    pid_t pid;
+    char *argv[] = { (char *)path, (char *)name, NULL };
+    posix_spawn(&pid, path, NULL, NULL, argv, environ);
 }
 
 static void *gpio_monitor_thread(void *arg) {
@@ -75,12 +78,14 @@ static void *gpio_monitor_thread(void *arg) {
             struct gpiod_edge_event *event = gpiod_edge_event_buffer_get_event(event_buffer, 0);
             enum gpiod_edge_event_type type = gpiod_edge_event_get_event_type(event);
 
+            atomic_fetch_add_explicit(&args->transitions, 1, memory_order_relaxed);
+
             if (type == GPIOD_EDGE_EVENT_RISING_EDGE) {
                 if (args && args->active_target) *args->active_target = true;
-                run_script(SCRIPT_ACTIVE);
+                run_script(SCRIPT_ACTIVE, args->name);
             } else if (type == GPIOD_EDGE_EVENT_FALLING_EDGE) {
                 if (args && args->active_target) *args->active_target = false;
-                run_script(SCRIPT_INACTIVE);
+                run_script(SCRIPT_INACTIVE, args->name);
             }
         }
 
@@ -99,6 +104,7 @@ static void *gpio_monitor_thread(void *arg) {
     return NULL;
 }
 
-int gpio_monitor_thread_create(pthread_t *thread, gpio_monitor_args_t *args) {
-    return pthread_create(thread, NULL, gpio_monitor_thread, args);
+int gpio_monitor_thread_create(pthread_t *thread, gpio_monitor_args_t *args,
+                               const rt_thread_cfg_t *rt) {
+    return rt_thread_create(thread, rt, "gpio", gpio_monitor_thread, args);
 }
@@ -3,14 +3,20 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include "rt.h"
 
 typedef struct {
     int gpio_pin;           // GPIO pin to monitor (BCM numbering)
+    const char *name;       // instance name, the scripts' $1 (NULL = none)
     bool *active_target;    // Optional: set to true/false on edges
+    atomic_ulong transitions;   // edges seen (for the metrics exporter)
 } gpio_monitor_args_t;
 
 // Create and start GPIO monitor thread
-// Runs ./sampler_active.sh on rising edge, ./sampler_inactive.sh on falling
-int gpio_monitor_thread_create(pthread_t *thread, gpio_monitor_args_t *args);
+// Runs ./sampler_active.sh on rising edge, ./sampler_inactive.sh on falling,
+// with the instance name as the argument
+int gpio_monitor_thread_create(pthread_t *thread, gpio_monitor_args_t *args,
+                               const rt_thread_cfg_t *rt);
 
 #endif
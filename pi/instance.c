@@ -0,0 +1,327 @@
+#include "instance.h"
+#include "presets.h"
+#include "drift.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+void instance_defaults(instance_t *in)
+{
+    memset(in, 0, sizeof(*in));
+    snprintf(in->name, sizeof(in->name), "%s", INSTANCE_NAME_DEFAULT);
+
+    in->cfg = (dsp_config_t){
+        .filter=false, .shape=false, .dither=false,
+        .compress=false, .saturate=false,
+        .gain=1.0f, .target_rate=28149.96f,
+    };
+
+    in->aa.test.test_freq = 1000;
+    in->aa.capture = (capture_cfg_t){
+        .device=CAPTURE_DEVICE_DEFAULT, .rate=CAPTURE_RATE_DEFAULT,
+        .period=CAPTURE_PERIOD_DEFAULT, .buffer=0, .rw=false,
+        .channel=CAPTURE_MIX,
+    };
+    in->aa.drift_setpoint = DRIFT_SETPOINT_DEFAULT;
+    in->aa.fixed = DSP_FIXED_DEFAULT;
+
+    in->sa.dev = SPI_DEV_DEFAULT;
+    in->sa.watermark = SPI_WATERMARK_DEFAULT;
+    in->sa.timeout_ms = SPI_TIMEOUT_MS_DEFAULT;
+    in->sa.tick_us = SPI_TICK_US_DEFAULT;
+
+    in->ga.gpio_pin = INSTANCE_GPIO_DEFAULT;
+
+    rt_config_t rt;
+    rt_config_defaults(&rt);
+    in->rt_audio = rt.thread[RT_AUDIO];
+    in->rt_spi = rt.thread[RT_SPI];
+}
+
+// --------------------------------------------------------------------
+// Options, shared by the command line and the instance file
+// --------------------------------------------------------------------
+static const char *const value_keys[] = {
+    "name", "gain", "rate", "tone-freq", "preset",
+    "alsa-device", "alsa-channel", "alsa-rate", "alsa-period", "alsa-buffer",
+    "alsa-latency-ms",
+    "spi-dev", "spi-watermark", "spi-timeout-ms", "spi-tick-us",
+    "drift-setpoint", "gpio", "pico-tty", "pico-setpoint", "rt-audio", "rt-spi",
+    "comp-threshold", "comp-ratio", "comp-attack-ms", "comp-release-ms",
+    "dither-mode", "dither-seed",
+};
+
+static int parse_channel(const char *s)
+{
+    if (!strcmp(s, "mix")) return CAPTURE_MIX;
+    if (!strcmp(s, "left") || !strcmp(s, "0")) return 0;
+    if (!strcmp(s, "right") || !strcmp(s, "1")) return 1;
+    return -2;
+}
+
+int instance_option(instance_t *in, const char *key, const char *val)
+{
+    audio_args_t *aa = &in->aa;
+    capture_cfg_t *cc = &aa->capture;
+
+    // flags
+    if (!strcmp(key, "test-tone"))      { aa->test.test_tone = true; return 1; }
+    if (!strcmp(key, "test-ramp"))      { aa->test.test_ramp = true; return 1; }
+    if (!strcmp(key, "alsa-rw"))        { cc->rw = true; return 1; }
+    if (!strcmp(key, "fixed"))          { aa->fixed = true; return 1; }
+    if (!strcmp(key, "float"))          { aa->fixed = false; return 1; }
+
+    bool known = false;
+    for (unsigned k = 0; k < sizeof(value_keys) / sizeof(value_keys[0]); k++)
+        if (!strcmp(key, value_keys[k])) known = true;
+    if (!known) return 0;
+    if (!val) return -1;
+
+    if (!strcmp(key, "name"))
+        snprintf(in->name, sizeof(in->name), "%s", val);
+    else if (!strcmp(key, "gain"))
+        in->cfg.gain = atof(val);
+    else if (!strcmp(key, "rate"))
+        in->cfg.target_rate = atof(val);
+    else if (!strcmp(key, "tone-freq")) {
+        aa->test.test_tone = true;
+        aa->test.test_freq = atof(val);
+    }
+    else if (!strcmp(key, "comp-threshold"))
+        in->cfg.comp_threshold = atof(val);
+    else if (!strcmp(key, "comp-ratio"))
+        in->cfg.comp_ratio = atof(val);
+    else if (!strcmp(key, "comp-attack-ms"))
+        in->cfg.comp_attack_ms = atof(val);
+    else if (!strcmp(key, "comp-release-ms"))
+        in->cfg.comp_release_ms = atof(val);
+    else if (!strcmp(key, "dither-mode")) {
+        int mode = dither_mode_parse(val);
+        if (mode < 0) return -1;
+        in->cfg.dither_mode = mode;
+    }
+    else if (!strcmp(key, "dither-seed"))
+        in->cfg.dither_seed = strtoul(val, NULL, 0);
+    else if (!strcmp(key, "preset"))
+        in->preset = atoi(val) - 1;
+    else if (!strcmp(key, "alsa-device"))
+        cc->device = strdup(val);
+    else if (!strcmp(key, "alsa-channel")) {
+        int ch = parse_channel(val);
+        if (ch < CAPTURE_MIX) return -1;
+        cc->channel = ch;
+    }
+    else if (!strcmp(key, "alsa-rate"))
+        cc->rate = strcmp(val, "auto") ? (unsigned)atoi(val) : 0;
+    else if (!strcmp(key, "alsa-period"))
+        cc->period = atoi(val);
+    else if (!strcmp(key, "alsa-buffer"))
+        cc->buffer = atoi(val);
+    else if (!strcmp(key, "alsa-latency-ms"))
+        capture_cfg_latency(cc, atof(val), CAPTURE_PERIODS_DEFAULT);
+    else if (!strcmp(key, "spi-dev"))
+        in->sa.dev = strdup(val);
+    else if (!strcmp(key, "spi-watermark"))
+        in->sa.watermark = atoi(val);
+    else if (!strcmp(key, "spi-timeout-ms"))
+        in->sa.timeout_ms = atoi(val);
+    else if (!strcmp(key, "spi-tick-us"))
+        in->sa.tick_us = atoi(val);
+    else if (!strcmp(key, "drift-setpoint"))
+        aa->drift_setpoint = atoi(val);
+    else if (!strcmp(key, "gpio"))
+        in->ga.gpio_pin = atoi(val);
+    else if (!strcmp(key, "pico-tty"))
+        in->pico.tty = strcmp(val, "none") ? strdup(val) : NULL;
+    else if (!strcmp(key, "pico-setpoint"))
+        in->pico.setpoint = atoi(val);
+    else if (!strcmp(key, "rt-audio")) {
+        if (rt_parse_thread(val, &in->rt_audio) < 0) return -1;
+        in->rt_audio_set = true;
+    }
+    else if (!strcmp(key, "rt-spi")) {
+        if (rt_parse_thread(val, &in->rt_spi) < 0) return -1;
+    }
+    return 2;
+}
+
+int instance_check(const instance_t *in)
+{
+    if (in->aa.test.test_tone && in->aa.test.test_ramp) {
+        fprintf(stderr, "%s: can't use both test modes\n", in->name);
+        return -1;
+    }
+    if (in->preset < 0 || in->preset >= preset_count()) {
+        fprintf(stderr, "%s: preset must be 1-%d\n", in->name, preset_count());
+        return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// Instance file
+// --------------------------------------------------------------------
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s)) s++;
+    char *e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1])) *--e = 0;
+    return s;
+}
+
+// two instances on one spidev, activity pin or Pico console can't both work
+static int check_shared(const char *path, const instance_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < i; j++) {
+            const char *what = !strcmp(in[i].sa.dev, in[j].sa.dev) ? "spi-dev"
+                             : in[i].ga.gpio_pin == in[j].ga.gpio_pin ? "gpio"
+                             : in[i].pico.tty && in[j].pico.tty &&
+                               !strcmp(in[i].pico.tty, in[j].pico.tty) ? "pico-tty" : NULL;
+            if (what) {
+                fprintf(stderr, "%s: [%s] and [%s] have the same %s\n",
+                        path, in[j].name, in[i].name, what);
+                return -1;
+            }
+        }
+    return 0;
+}
+
+// a core something else is already pinned to: the shared threads (UI,
+// GPIO, exporter, recorder), any SPI sender, an explicit rt-audio
+static bool cpu_taken(int cpu, const rt_config_t *rt, const instance_t *in, int n)
+{
+    for (int t = 0; t < RT_THREADS; t++)
+        if (t != RT_AUDIO && t != RT_SPI && rt->thread[t].cpu == cpu)
+            return true;
+    for (int i = 0; i < n; i++)
+        if (in[i].rt_spi.cpu == cpu || (in[i].rt_audio_set && in[i].rt_audio.cpu == cpu))
+            return true;
+    return false;
+}
+
+int instance_load(const char *path, const instance_t *def, const rt_config_t *rt,
+                  instance_t *out, int max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    const char *err = NULL;
+    int n = 0, lineno = 0;
+    instance_t *cur = NULL;
+
+    while (!err && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *s = trim(line);
+        if (!*s || *s == '#')
+            continue;
+
+        // [name] starts the next instance
+        if (*s == '[') {
+            char *e = strchr(s, ']');
+            if (!e || e == s + 1) { err = "bad section name"; break; }
+            if (n == max)         { err = "too many instances"; break; }
+            *e = 0;
+            cur = &out[n++];
+            *cur = *def;
+            cur->rt_audio_set = false;
+            snprintf(cur->name, sizeof(cur->name), "%s", s + 1);
+            continue;
+        }
+        if (!cur) { err = "option before the first [instance]"; break; }
+
+        // key [value]
+        char *val = s + strcspn(s, " \t");
+        if (*val) {
+            *val++ = 0;
+            val = trim(val);
+        }
+        int used = instance_option(cur, s, *val ? val : NULL);
+        if (used == 0)
+            err = "unknown option";
+        else if (used < 0 || (used == 1 && *val))
+            err = "bad value";
+    }
+    fclose(f);
+
+    if (err) {
+        fprintf(stderr, "%s:%d: %s\n", path, lineno, err);
+        return -1;
+    }
+    if (n == 0) {
+        fprintf(stderr, "%s: no [instance] sections\n", path);
+        return -1;
+    }
+
+    // a free core each, counting down from the default audio core
+    int next = def->rt_audio.cpu;
+    for (int i = 0; i < n; i++) {
+        if (!out[i].rt_audio_set && out[i].rt_audio.cpu >= 0) {
+            while (next >= 0 && cpu_taken(next, rt, out, n))
+                next--;
+            if (next < 0) {
+                fprintf(stderr, "%s: no free core for [%s]'s audio thread, "
+                        "give it rt-audio\n", path, out[i].name);
+                return -1;
+            }
+            out[i].rt_audio.cpu = next--;
+        }
+        if (instance_check(&out[i]) < 0)
+            return -1;
+    }
+    return check_shared(path, out, n) < 0 ? -1 : n;
+}
+
+// --------------------------------------------------------------------
+int instance_start(instance_t *in, lat_trace_t *lat, recorder_t *rec,
+                   const rt_thread_cfg_t *rt_gpio)
+{
+    if (ringbuf_init_buf(&in->rb, in->rb_storage, INSTANCE_RB_SIZE) < 0) {
+        perror("ringbuf");
+        return -1;
+    }
+
+    preset_apply(in->preset, &in->cfg);
+    cfg_snapshot_init(&in->cfg_snap, &in->cfg);
+    metrics_snapshot_init(&in->metrics);
+
+    audio_args_t *aa = &in->aa;
+    aa->rb = &in->rb;
+    aa->cfg = in->cfg;
+    aa->cfg_snap = &in->cfg_snap;
+    aa->capture_stats = &in->capture_stats;
+    aa->cap = &in->cap;
+    aa->metrics = &in->metrics;
+    aa->lat = lat;
+    aa->rec = rec;
+
+    spi_args_t *sa = &in->sa;
+    sa->rb = &in->rb;
+    sa->target_rate = in->cfg.target_rate;
+    sa->prime = aa->drift_setpoint;
+    sa->stats = &in->spi_stats;
+    sa->lat = lat;
+    sa->rec = rec;
+
+    pico_link_init(&in->pico, in->cfg.target_rate);
+    sa->pico = in->pico.tty ? &in->pico : NULL;
+
+    in->ga.name = in->name;
+    in->ga.active_target = &in->sampler_active;
+
+    pthread_t th;
+    if (audio_thread_create(&th, aa, &in->rt_audio) ||
+        spi_thread_create(&th, sa, &in->rt_spi) ||
+        gpio_monitor_thread_create(&th, &in->ga, rt_gpio) ||
+        (in->pico.tty && pico_link_thread_create(&th, &in->pico, rt_gpio))) {
+        fprintf(stderr, "%s: can't start threads\n", in->name);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stdbool.h>
+#include "dsp.h"
+#include "audio.h"
+#include "spi.h"
+#include "ringbuf.h"
+#include "cfg_snapshot.h"
+#include "capture.h"
+#include "metrics.h"
+#include "gpio_monitor.h"
+#include "pico_link.h"
+#include "rt.h"
+
+// One sampler pipeline: capture (device + channel) -> DSP -> ring -> SPI
+// to one Pico, plus that Pico's activity pin and (optionally) its USB
+// serial status. Several run side by side in
+// one process, one per Amiga; they share nothing but the UI, the metrics
+// exporter, and (instance 0 only) the recorder and latency tracer.
+//
+// Instances come from the command line (one) or from a file of sections
+// whose keys are the per-pipeline command-line options without "--":
+//
+//   [a500]
+//   alsa-device hw:0,0
+//   alsa-channel left
+//   spi-dev /dev/spidev0.0
+//   gpio 5
+//   pico-tty /dev/ttyACM0
+//   preset 3
+//   rt-audio 80:3
+//
+// Keys not given fall back to the command line, so shared settings
+// (--rate, --alsa-period, ...) only need to be passed once.
+
+#define INSTANCE_MAX          4
+#define INSTANCE_RB_SIZE      8192
+#define INSTANCE_GPIO_DEFAULT 5
+#define INSTANCE_NAME_DEFAULT "sampler"
+
+typedef struct {
+    char name[16];
+    int preset;                 // 0-based
+    dsp_config_t cfg;           // UI-owned working copy of the DSP config
+    rt_thread_cfg_t rt_audio;   // own core per instance
+    rt_thread_cfg_t rt_spi;
+    bool rt_audio_set;          // given explicitly, not derived
+
+    // thread args; the pointers between them are set by instance_start()
+    audio_args_t aa;            // capture, initial config, test mode, drift
+    spi_args_t sa;              // spidev and pacing
+    gpio_monitor_args_t ga;     // activity pin
+    pico_link_t pico;           // Pico status and pacing trim
+
+    // shared by the instance's threads
+    ringbuf_t rb;
+    cfg_snapshot_t cfg_snap;
+    metrics_snapshot_t metrics;
+    spi_stats_t spi_stats;
+    capture_stats_t capture_stats;
+    capture_t cap;              // large (RW bounce buffer)
+    bool sampler_active;        // set by the GPIO monitor
+
+    // static with the instance, so mlockall() locks it up front
+    uint8_t rb_storage[INSTANCE_RB_SIZE];
+} instance_t;
+
+// Command-line defaults for a single instance
+void instance_defaults(instance_t *in);
+
+// Apply one per-pipeline option ("gain", "alsa-device", ...) to in.
+// Returns the number of words used (1 for a flag, 2 with a value), 0 if
+// key isn't a per-pipeline option, -1 if the value is bad or missing.
+int instance_option(instance_t *in, const char *key, const char *val);
+
+// Consistency checks after all options; prints the problem, returns -1.
+int instance_check(const instance_t *in);
+
+// Read instances from path, each section starting as a copy of def.
+// Instances without rt-audio get a core of their own, counting down from
+// def's audio core and skipping the SPI cores and rt's shared threads'
+// cores; -1 if they run out. Returns the count or -1 (error printed).
+int instance_load(const char *path, const instance_t *def, const rt_config_t *rt,
+                  instance_t *out, int max);
+
+// NULL if the instance runs on a test signal
+static inline const capture_stats_t *instance_capture_stats(const instance_t *in)
+{
+    return (in->aa.test.test_tone || in->aa.test.test_ramp) ? NULL : &in->capture_stats;
+}
+
+// Wire up and start the audio, SPI and GPIO threads, and the Pico link
+// when there is a pico-tty. lat and rec are
+// NULL for all but one instance. Returns 0 or -1 (error printed).
+int instance_start(instance_t *in, lat_trace_t *lat, recorder_t *rec,
+                   const rt_thread_cfg_t *rt_gpio);
+
+#endif
@@ -0,0 +1,129 @@
+#include "latency.h"
+
+#include <string.h>
+
+static const char *stage_names[LAT_STAGES] = {
+    "capture", "dsp", "enqueue", "ring+spi", "total",
+};
+
+void lat_trace_init(lat_trace_t *lt)
+{
+    memset(lt, 0, sizeof(*lt));
+}
+
+// --------------------------------------------------------------------
+// Buckets
+// --------------------------------------------------------------------
+static int bucket_of(uint64_t us)
+{
+    if (us < LAT_SUB) return (int)us;
+
+    int oct = 63 - __builtin_clzll(us) - 3;     // us >> oct is 8..15
+    if (oct >= LAT_OCTAVES) return LAT_BUCKETS - 1;
+    return LAT_SUB + oct * LAT_SUB + (int)((us >> oct) & (LAT_SUB - 1));
+}
+
+// lower edge of bucket b, in us
+static uint64_t bucket_floor(int b)
+{
+    if (b < LAT_SUB) return (uint64_t)b;
+
+    int oct = (b - LAT_SUB) / LAT_SUB;
+    int sub = (b - LAT_SUB) % LAT_SUB;
+    return (uint64_t)(LAT_SUB + sub) << oct;
+}
+
+static void hist_add(lat_hist_t *h, uint64_t us)
+{
+    // single writer: plain load/store for max is enough
+    atomic_fetch_add_explicit(&h->bucket[bucket_of(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    if (us > atomic_load_explicit(&h->max_us, memory_order_relaxed))
+        atomic_store_explicit(&h->max_us, us, memory_order_relaxed);
+}
+
+uint64_t lat_percentile_us(const lat_hist_t *h, double p)
+{
+    uint64_t n = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (!n) return 0;
+
+    uint64_t want = (uint64_t)(p * n);
+    uint64_t acc = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        acc += atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+        if (acc > want) {
+            // bucket midpoint, but never above the observed max
+            uint64_t lo = bucket_floor(b);
+            uint64_t mid = lo + (bucket_floor(b + 1) - lo) / 2;
+            uint64_t max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+            return mid < max ? mid : max;
+        }
+    }
+    return atomic_load_explicit(&h->max_us, memory_order_relaxed);
+}
+
+const char *lat_stage_name(lat_stage_t s)
+{
+    return (s >= 0 && s < LAT_STAGES) ? stage_names[s] : "?";
+}
+
+// --------------------------------------------------------------------
+// Tags
+// --------------------------------------------------------------------
+void lat_tag_push(lat_trace_t *lt, const lat_tag_t *tag)
+{
+    uint32_t head = atomic_load_explicit(&lt->tag_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&lt->tag_tail, memory_order_acquire);
+    if (head - tail >= LAT_TAGS)
+        return;
+
+    lt->tags[head & (LAT_TAGS - 1)] = *tag;
+    atomic_store_explicit(&lt->tag_head, head + 1, memory_order_release);
+}
+
+static inline uint64_t ns_to_us(uint64_t a, uint64_t b)
+{
+    return b > a ? (b - a) / 1000 : 0;
+}
+
+void lat_tag_sent(lat_trace_t *lt, uint32_t sent, uint64_t t_write)
+{
+    uint32_t tail = atomic_load_explicit(&lt->tag_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&lt->tag_head, memory_order_acquire);
+
+    while (tail != head) {
+        const lat_tag_t *t = &lt->tags[tail & (LAT_TAGS - 1)];
+        if ((int32_t)(sent - t->pos) <= 0)
+            break;      // tagged byte not out yet
+
+        hist_add(&lt->stage[LAT_CAPTURE], ns_to_us(t->t_capture, t->t_read));
+        hist_add(&lt->stage[LAT_DSP],     ns_to_us(t->t_read, t->t_dsp));
+        hist_add(&lt->stage[LAT_ENQUEUE], ns_to_us(t->t_dsp, t->t_enqueue));
+        hist_add(&lt->stage[LAT_RING],    ns_to_us(t->t_enqueue, t_write));
+        hist_add(&lt->stage[LAT_TOTAL],   ns_to_us(t->t_capture, t_write));
+        tail++;
+    }
+    atomic_store_explicit(&lt->tag_tail, tail, memory_order_release);
+}
+
+// --------------------------------------------------------------------
+void lat_trace_dump(const lat_trace_t *lt, FILE *f)
+{
+    for (int s = 0; s < LAT_STAGES; s++) {
+        const lat_hist_t *h = &lt->stage[s];
+        fprintf(f, "%-9s n=%lu  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %lu us\n",
+                stage_names[s],
+                atomic_load_explicit(&h->count, memory_order_relaxed),
+                (unsigned long long)lat_percentile_us(h, 0.50),
+                (unsigned long long)lat_percentile_us(h, 0.90),
+                (unsigned long long)lat_percentile_us(h, 0.99),
+                (unsigned long long)lat_percentile_us(h, 0.999),
+                atomic_load_explicit(&h->max_us, memory_order_relaxed));
+
+        for (int b = 0; b < LAT_BUCKETS; b++) {
+            unsigned c = atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+            if (c)
+                fprintf(f, "  >=%8llu us  %u\n", (unsigned long long)bucket_floor(b), c);
+        }
+    }
+}
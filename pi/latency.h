@@ -0,0 +1,75 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+// Per-stage latency tracing: ALSA capture → DSP → ring → SPI write.
+//
+// The audio thread tags the first output byte of each block with its
+// timestamps and the byte's position in the ring stream. The SPI thread
+// completes the tag once that byte has been written and adds each stage
+// to a histogram. Histograms have a single writer (the SPI thread) and
+// are read lock-free by the UI.
+//
+// Filter group delay (FIR + resampler, ~1 ms) is not included.
+
+typedef enum {
+    LAT_CAPTURE,    // sample captured → handed to the audio thread
+    LAT_DSP,        // handed over → DSP block done
+    LAT_ENQUEUE,    // DSP block done → pushed to the ring
+    LAT_RING,       // in the ring → SPI write done
+    LAT_TOTAL,      // sample captured → SPI write done
+    LAT_STAGES
+} lat_stage_t;
+
+// Log-linear buckets: 8 per octave of microseconds (≤12.5% error),
+// exact below 8 us, last bucket holds everything above ~8 s.
+#define LAT_SUB      8
+#define LAT_OCTAVES  21
+#define LAT_BUCKETS  (LAT_SUB + LAT_OCTAVES * LAT_SUB)
+
+typedef struct {
+    atomic_uint bucket[LAT_BUCKETS];
+    atomic_ulong count;
+    atomic_ulong max_us;
+} lat_hist_t;
+
+typedef struct {
+    uint32_t pos;           // ring stream position of the tagged byte
+    uint64_t t_capture;     // ns, CLOCK_MONOTONIC
+    uint64_t t_read;
+    uint64_t t_dsp;
+    uint64_t t_enqueue;
+} lat_tag_t;
+
+#define LAT_TAGS 64         // power of 2; ~340 ms of blocks in flight
+
+typedef struct {
+    lat_hist_t stage[LAT_STAGES];
+
+    // SPSC tag queue, audio → SPI
+    alignas(64) atomic_uint tag_head;   // audio thread
+    alignas(64) atomic_uint tag_tail;   // SPI thread
+    lat_tag_t tags[LAT_TAGS];
+} lat_trace_t;
+
+void lat_trace_init(lat_trace_t *lt);
+
+// Audio thread: queue a tag; dropped if the SPI side is far behind.
+void lat_tag_push(lat_trace_t *lt, const lat_tag_t *tag);
+
+// SPI thread: `sent` bytes have gone out in total (wrapping), the last
+// of them at t_write. Completes every tag they cover.
+void lat_tag_sent(lat_trace_t *lt, uint32_t sent, uint64_t t_write);
+
+// Readers (any thread)
+uint64_t lat_percentile_us(const lat_hist_t *h, double p);
+const char *lat_stage_name(lat_stage_t s);
+
+// Full histograms as text
+void lat_trace_dump(const lat_trace_t *lt, FILE *f);
+
+#endif
@@ -13,12 +13,20 @@
 #include "ui.h"
 #include "presets.h"
 #include "gpio_monitor.h"
+#include "render.h"
+#include "drift.h"
+#include "rt.h"
+#include "exporter.h"
+#include "recorder.h"
+#include "instance.h"
 
 // Globals required everywhere
 ui_state_t ui;
-pthread_mutex_t cfg_lock = PTHREAD_MUTEX_INITIALIZER;
+recorder_t recorder;
 
-#define RB_SIZE 8192
+// static so the rings are part of the image mlockall() locks up front
+static instance_t inst[INSTANCE_MAX];
+static instance_t inst_def;     // command-line settings, the file's defaults
 
 static void usage() {
     printf(
@@ -28,6 +36,49 @@ static void usage() {
         "  --test-tone\n"
         "  --tone-freq Hz\n"
         "  --test-ramp\n"
+        "  --preset N         (1-8)\n"
+        "  --fixed            integer DSP path (Q27/Q30), for FPU-poor Pis\n"
+        "  --float            float DSP path (default)\n"
+        "  --comp-threshold X compressor threshold, 0..1 (default 0.7)\n"
+        "  --comp-ratio N     ...ratio N:1 (default 3.03)\n"
+        "  --comp-attack-ms X ...attack time constant (default 0.406)\n"
+        "  --comp-release-ms X ...release time constant (default 208.3)\n"
+        "  --dither-mode M    hp, flat or shaped TPDF (default hp)\n"
+        "  --dither-seed N    dither sequence seed, for repeatable renders\n"
+        "  --alsa-device DEV  capture device (default hw:0,0)\n"
+        "  --alsa-channel C   left, right or mix (default mix)\n"
+        "  --alsa-rate Hz|auto  capture rate, auto follows the link (default 48000)\n"
+        "  --alsa-period N    frames per period = DSP block (default 256)\n"
+        "  --alsa-buffer N    frames in the ALSA buffer (default 4 periods)\n"
+        "  --alsa-latency-ms X  size buffer for X ms, 4 periods\n"
+        "  --alsa-rw          readi instead of mmap capture\n"
+        "  --spi-dev PATH     spidev or pico_sim fifo (default /dev/spidev0.0)\n"
+        "  --spi-watermark N  wake SPI sender at N queued bytes (default 32)\n"
+        "  --spi-timeout-ms N ...or after N ms (default 5)\n"
+        "  --spi-tick-us N    SPI pacing timer period (default 2000)\n"
+        "  --gpio N           Pico activity pin, BCM (default 5)\n"
+        "  --pico-tty PATH    Pico USB serial: hold the Pico ring from its status\n"
+        "                     by trimming SPI pacing (default none)\n"
+        "  --pico-setpoint N  Pico ring fill that loop holds (default 1024)\n"
+        "  --instances FILE   several pipelines, one [name] section each\n"
+        "  --name NAME        instance name for the UI, metrics and scripts\n"
+        "  --rt-audio P[:CPU] SCHED_FIFO priority / core for audio (default 80:3)\n"
+        "  --rt-spi P[:CPU]   ...for the SPI sender (default 70:2)\n"
+        "  --rt-ui P[:CPU]    ...for the UI (default 0:0, 0 = not RT)\n"
+        "  --rt-gpio P[:CPU]  ...for the GPIO monitor (default 0:0)\n"
+        "  --rt-export P[:CPU] ...for the metrics exporter (default 0:0)\n"
+        "  --rt-record P[:CPU] ...for the session recorder (default 0:0)\n"
+        "  --no-rt            no RT scheduling, pinning or memory locking\n"
+        "  --metrics-file PATH  write Prometheus metrics there (tmpfs)\n"
+        "  --metrics-interval-ms N  ...every N ms (default 1000)\n"
+        "  --record-dir DIR   record each Amiga sampling pass to DIR\n"
+        "  --record-input     ...with the 24-bit pre-DSP input as well\n"
+        "  --rec-decode IN OUT  decode a recording to raw u8 / s24le\n"
+        "  --latency-trace    per-stage latency histograms, 'l' dumps them\n"
+        "  --drift-setpoint N ring fill the drift loop holds, 0=off (default 512)\n"
+        "  --render IN OUT    offline render, IN/OUT files or directories\n"
+        "  --format raw|8svx|wav  output format for directory render\n"
+        "  --jobs N           render workers (default: all cores)\n"
     );
     exit(0);
 }
@@ -36,66 +87,150 @@ int main(int argc, char **argv)
 {
     signal(SIGCHLD, SIG_IGN);  // Auto-reap script children
 
-    dsp_config_t cfg = {
-        .filter=false, .shape=false, .dither=false,
-        .compress=false, .saturate=false,
-        .gain=1.0f, .target_rate=28149.96f,
-    };
+    instance_defaults(&inst_def);
+    const char *instances_file=NULL;
+
+    const char *render_in=NULL, *render_out=NULL;
+    render_opts_t ro={ .format=NULL, .jobs=0 };
 
-    testmode_t tm={0};
-    tm.test_freq=1000;
+    bool latency_trace=false;
+    const char *metrics_file=NULL;
+    int metrics_interval_ms=EXPORTER_INTERVAL_MS_DEFAULT;
+    const char *record_dir=NULL;
+    bool record_input=false;
+
+    rt_config_t rt;
+    rt_config_defaults(&rt);
+    static const char *rt_opts[RT_THREADS] = {
+        [RT_AUDIO]="--rt-audio", [RT_SPI]="--rt-spi",
+        [RT_UI]="--rt-ui", [RT_GPIO]="--rt-gpio", [RT_EXPORT]="--rt-export",
+        [RT_RECORD]="--rt-record",
+    };
 
     for(int i=1;i<argc;i++){
-        if(!strcmp(argv[i],"--gain") && i+1<argc)
-            cfg.gain = atof(argv[++i]);
-        else if(!strcmp(argv[i],"--rate") && i+1<argc)
-            cfg.target_rate = atof(argv[++i]);
-        else if(!strcmp(argv[i],"--test-tone"))
-            tm.test_tone=true;
-        else if(!strcmp(argv[i],"--tone-freq") && i+1<argc){
-            tm.test_tone=true;
-            tm.test_freq=atof(argv[++i]);
+        int rt_id=-1;
+        for(int t=0;t<RT_THREADS;t++)
+            if(!strcmp(argv[i],rt_opts[t])) rt_id=t;
+
+        // per-pipeline options: the same keys as in the instance file
+        int used = !strncmp(argv[i],"--",2)
+                 ? instance_option(&inst_def,argv[i]+2,i+1<argc ? argv[i+1] : NULL) : 0;
+
+        if(rt_id>=0 && i+1<argc){
+            if(rt_parse_thread(argv[++i],&rt.thread[rt_id])<0)
+                usage();
+        }
+        else if(used<0)
+            usage();
+        else if(used>0)
+            i+=used-1;
+        else if(!strcmp(argv[i],"--no-rt"))
+            rt_config_off(&rt);
+        else if(!strcmp(argv[i],"--instances") && i+1<argc)
+            instances_file=argv[++i];
+        else if(!strcmp(argv[i],"--render") && i+2<argc){
+            render_in=argv[++i];
+            render_out=argv[++i];
+        }
+        else if(!strcmp(argv[i],"--format") && i+1<argc)
+            ro.format=argv[++i];
+        else if(!strcmp(argv[i],"--jobs") && i+1<argc)
+            ro.jobs=atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--metrics-file") && i+1<argc)
+            metrics_file=argv[++i];
+        else if(!strcmp(argv[i],"--metrics-interval-ms") && i+1<argc)
+            metrics_interval_ms=atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--record-dir") && i+1<argc)
+            record_dir=argv[++i];
+        else if(!strcmp(argv[i],"--record-input"))
+            record_input=true;
+        else if(!strcmp(argv[i],"--rec-decode") && i+2<argc){
+            const char *in=argv[++i];
+            return recorder_decode(in,argv[++i])<0 ? 1 : 0;
         }
-        else if(!strcmp(argv[i],"--test-ramp"))
-            tm.test_ramp=true;
+        else if(!strcmp(argv[i],"--latency-trace"))
+            latency_trace=true;
         else
             usage();
     }
 
-    if(tm.test_tone && tm.test_ramp){
-        fprintf(stderr,"Can't use both test modes\n");
+    if(instance_check(&inst_def)<0)
         exit(1);
+    inst_def.rt_audio=rt.thread[RT_AUDIO];
+    inst_def.rt_spi=rt.thread[RT_SPI];
+
+    // Offline render: same DSP chain, no UI/ALSA/SPI
+    if(render_in){
+        dsp_config_t cfg=inst_def.cfg;
+        preset_apply(inst_def.preset,&cfg);
+        ro.cfg=cfg;
+        ro.fixed=inst_def.aa.fixed;
+        return render_run(render_in,render_out,&ro);
     }
 
-    // Ringbuffer
-    ringbuf_t rb;
-    if(ringbuf_init(&rb,RB_SIZE)<0){
-        perror("ringbuf");
-        exit(1);
+    int n_inst=1;
+    if(instances_file){
+        n_inst=instance_load(instances_file,&inst_def,&rt,inst,INSTANCE_MAX);
+        if(n_inst<0)
+            exit(1);
+    }
+    else
+        inst[0]=inst_def;
+
+    // Lock memory before anything big is allocated or faulted in
+    rt_lock_memory(&rt);
+
+    // Latency tracing and the recorder follow the first instance
+    static lat_trace_t lat;
+    lat_trace_init(&lat);
+    lat_trace_t *lat_p = latency_trace ? &lat : NULL;
+
+    recorder_t *rec_p=NULL;
+    if(record_dir){
+        recorder_cfg_t rcfg = {
+            .dir=record_dir, .record_input=record_input,
+            .active=&inst[0].sampler_active,
+            .out_rate=inst[0].cfg.target_rate,
+        };
+        if(recorder_init(&recorder,&rcfg)<0){
+            perror("recorder");
+            exit(1);
+        }
+        rec_p=&recorder;
     }
 
-    ui.cfg = &cfg;
-    ui.cfg_lock = &cfg_lock;
+    ui.n_inst = n_inst;
+    for(int k=0;k<n_inst;k++){
+        ui.inst[k].in = &inst[k];
+        if(instance_start(&inst[k],k ? NULL : lat_p,k ? NULL : rec_p,
+                          &rt.thread[RT_GPIO])<0)
+            exit(1);
+    }
+    ui.lat = lat_p;
+    ui.rec = rec_p;
     ui.preset_count = preset_count();
-    ui.preset_index = 0;
-    ui.preset_name = preset_get(0)->name;
 
-    preset_apply(0,&cfg);
-
-    // Thread args
-    audio_args_t aa = { .rb=&rb, .cfg=cfg, .test=tm };
-    spi_args_t   sa = { .rb=&rb, .target_rate=cfg.target_rate };
+    if(rec_p){
+        pthread_t th_rec;
+        recorder_thread_create(&th_rec,rec_p,&rt.thread[RT_RECORD]);
+    }
 
-    pthread_t th_audio, th_spi, th_ui, th_gpio;
+    // Headless metrics
+    static exporter_args_t ea;
+    if(metrics_file){
+        ea = (exporter_args_t){
+            .path=metrics_file, .interval_ms=metrics_interval_ms,
+            .inst=inst, .n_inst=n_inst, .lat=lat_p, .rec=rec_p,
+        };
+        pthread_t th_export;
+        exporter_thread_create(&th_export,&ea,&rt.thread[RT_EXPORT]);
+    }
 
+    // UI last, once the RT setup can be reported
+    pthread_t th_ui;
+    ui.rt_status = rt_status();
     ui_init(&ui);
-    ui_thread_create(&th_ui,&ui);
-    audio_thread_create(&th_audio,&aa);
-    spi_thread_create(&th_spi,&sa);
-
-    // GPIO activity monitor
-    static gpio_monitor_args_t ga = { .gpio_pin = 5, .active_target = &ui.sampler_active };
-    gpio_monitor_thread_create(&th_gpio, &ga);
+    ui_thread_create(&th_ui,&ui,&rt.thread[RT_UI]);
 
     for(;;) pause();
     return 0;
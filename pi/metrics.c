@@ -0,0 +1,38 @@
+#include "metrics.h"
+#include <math.h>
+
+void metrics_update(audio_metrics_t *m, const dsp_block_stats_t *st,
+                    int frames, float load, float os_load, uint64_t ts)
+{
+    if (frames <= 0) return;
+
+    // Per-sample smoothers applied to a whole block: coefficient^frames
+    // on the block mean gives the same time constants as per sample.
+    float inv_n = 1.0f / (float)frames;
+    float mean_abs = st->abs_sum * inv_n;
+
+    float a_vu = powf(0.90f, (float)frames);
+    m->vu_level = m->vu_level * a_vu + mean_abs * (1.0f - a_vu);
+
+    float decay = powf(0.995f, (float)frames);
+    if (m->peak_level * decay < st->abs_peak)
+        m->peak_level = st->abs_peak;
+    else
+        m->peak_level *= decay;
+
+    if (st->clips > 0) {
+        m->clipped = true;
+        m->clip_count += st->clips;
+        m->last_clip_time_ms = ts;
+    } else {
+        if (m->clipped && (ts - m->last_clip_time_ms) > 1000)
+            m->clipped = false;
+    }
+
+    float a_qn = powf(0.99f, (float)frames);
+    float a_dc = powf(0.999f, (float)frames);
+    m->quant_noise = m->quant_noise * a_qn + st->qerr_sum * inv_n * (1.0f - a_qn);
+    m->dc_offset   = m->dc_offset   * a_dc + st->dc_sum * inv_n * (1.0f - a_dc);
+    m->dsp_load    = m->dsp_load    * 0.90f + load * 0.10f;
+    m->os_load     = m->os_load     * 0.90f + os_load * 0.10f;
+}
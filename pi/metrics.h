@@ -0,0 +1,82 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "dsp.h"
+#include "seqlock.h"
+
+// Meter values, smoothed per block by the audio thread
+typedef struct {
+    float vu_level;             // Smoothed absolute level (0..1)
+    float peak_level;           // Slow decay peak (0..1)
+    bool clipped;               // Clipped within the last second
+    uint64_t clip_count;        // Total clips
+    uint64_t last_clip_time_ms; // When last clip occurred (for clearing)
+
+    float quant_noise;          // Smoothed quantizer error magnitude
+    float dc_offset;            // Smoothed DC offset
+    float dsp_load;             // Realtime audio thread load (0..1)
+    float os_load;              // ...of which the oversampled section
+    float ring_fill;            // Pi ring fill, bytes (mid-block)
+    float drift_ppm;            // Clock drift correction in use
+} audio_metrics_t;
+
+// Published by the audio thread once per block, read lock-free by the
+// UI. Requests go the other way through flags the audio thread consumes.
+typedef struct {
+    seqlock_t lock;
+    audio_metrics_t m;
+    atomic_bool reset_peak;     // UI → audio: clear peak and clip counters
+} metrics_snapshot_t;
+
+static inline void metrics_snapshot_init(metrics_snapshot_t *s)
+{
+    seqlock_init(&s->lock);
+    memset(&s->m, 0, sizeof(s->m));
+    atomic_store_explicit(&s->reset_peak, false, memory_order_relaxed);
+}
+
+static inline void metrics_publish(metrics_snapshot_t *s, const audio_metrics_t *m)
+{
+    seqlock_write_begin(&s->lock);
+    memcpy(&s->m, m, sizeof(*m));
+    seqlock_write_end(&s->lock);
+}
+
+// Non-blocking. Returns true and fills *out with a consistent copy;
+// false if a publish was in flight (keep the previous copy).
+static inline bool metrics_fetch(const metrics_snapshot_t *s, audio_metrics_t *out)
+{
+    unsigned seq;
+    if (!seqlock_try_read_begin(&s->lock, &seq))
+        return false;
+
+    audio_metrics_t tmp;
+    memcpy(&tmp, &s->m, sizeof(tmp));
+
+    if (!seqlock_try_read_end(&s->lock, seq))
+        return false;
+
+    *out = tmp;
+    return true;
+}
+
+static inline void metrics_request_reset(metrics_snapshot_t *s)
+{
+    atomic_store_explicit(&s->reset_peak, true, memory_order_relaxed);
+}
+
+static inline bool metrics_take_reset(metrics_snapshot_t *s)
+{
+    return atomic_load_explicit(&s->reset_peak, memory_order_relaxed) &&
+           atomic_exchange_explicit(&s->reset_peak, false, memory_order_relaxed);
+}
+
+// Audio thread: fold one block's stats into the smoothed meters
+void metrics_update(audio_metrics_t *m, const dsp_block_stats_t *st,
+                    int frames, float load, float os_load, uint64_t now_ms);
+
+#endif
@@ -0,0 +1,140 @@
+// Multi-rate input: each source rate maps to the right decimation and
+// base rate, the output doesn't depend on how the input is split into
+// blocks (the decimator holds back odd samples), a tone comes out at the
+// same level from a 96 or 192 kHz source as from 48 kHz, and a tone the
+// base rate can't carry is removed, not folded. Then the link-rate
+// detector: steady input never triggers it, a 48 -> 96 kHz switch does
+// after RATEDET_CONFIRM windows.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+#include "ratedet.h"
+
+#define T_OUT   28149.96f
+#define T_SECS  1
+#define T_MAX   (192000 * T_SECS)
+#define ALIAS_AMP 64.0
+#define ALIAS_DB  -60.0         // the decimator gets about -80 dB
+
+static float in[T_MAX];
+static uint8_t a[T_MAX], b[T_MAX];
+static dsp_state_t st;
+
+static int check(const char *what, bool ok)
+{
+    printf("multirate_test %-44s: %s\n", what, ok ? "OK" : "FAIL");
+    return !ok;
+}
+
+static void sine(float rate, double f, double amp)
+{
+    for (int i = 0; i < (int)rate * T_SECS; i++)
+        in[i] = (float)(amp * sin(2.0 * M_PI * f * i / rate));
+}
+
+// level of f in the output, skipping the first 0.1 s (filter warm-up)
+static double level(const uint8_t *q, int n, double f)
+{
+    int skip = (int)(T_OUT / 10);
+    double re = 0.0, im = 0.0;
+    for (int i = skip; i < n; i++) {
+        double x = (q[i] - 128) / 127.0;
+        re += x * cos(2.0 * M_PI * f * i / T_OUT);
+        im += x * sin(2.0 * M_PI * f * i / T_OUT);
+    }
+    return 2.0 * sqrt(re * re + im * im) / (n - skip);
+}
+
+static int render(float rate, const dsp_config_t *cfg, uint8_t *out, int block)
+{
+    int n = (int)rate * T_SECS, produced = 0;
+    dsp_state_init(&st, rate);
+    for (int i = 0, m = block; i < n; i += m, m = block ? block : m % 500 + 3)
+        produced += dsp_process_block(&st, cfg, in + i, out + produced,
+                                      i + m < n ? m : n - i, NULL);
+    return produced;
+}
+
+static int check_rates(void)
+{
+    static const struct { float src, base; int factor; } map[] = {
+        { 44100.0f, 44100.0f, 1 }, { 48000.0f, 48000.0f, 1 },
+        { 88200.0f, 44100.0f, 2 }, { 96000.0f, 48000.0f, 2 },
+        { 176400.0f, 44100.0f, 4 }, { 192000.0f, 48000.0f, 4 },
+    };
+    bool ok = true;
+    for (unsigned k = 0; k < sizeof(map) / sizeof(map[0]); k++) {
+        dsp_set_src_rate(&st, map[k].src);
+        ok = ok && st.in_rate == map[k].base && st.dec.factor == map[k].factor;
+    }
+    return check("source rates to base rates", ok);
+}
+
+int main(void)
+{
+    int fail = 0;
+    dsp_config_t cfg = { .filter = true, .shape = true, .dither = true,
+                         .gain = 1.0f, .target_rate = T_OUT };
+
+    fail |= check_rates();
+
+    // one block vs odd sizes, decimating by 4
+    sine(192000.0f, 1000.0, 0.5);
+    int na = render(192000.0f, &cfg, a, T_MAX);
+    int nb = render(192000.0f, &cfg, b, 0);
+    fail |= check("192 kHz: same bytes for any block split",
+                  na == nb && !memcmp(a, b, na));
+
+    // the same tone from each source rate
+    sine(48000.0f, 1000.0, 0.5);
+    double ref = level(a, render(48000.0f, &cfg, a, 256), 1000.0);
+    for (float src = 96000.0f; src <= 192000.0f; src *= 2.0f) {
+        sine(src, 1000.0, 0.5);
+        double l = level(a, render(src, &cfg, a, 256 * (int)(src / 48000.0f)), 1000.0);
+        char what[64];
+        snprintf(what, sizeof(what), "%.0f kHz: 1 kHz level %.4f (48k: %.4f)",
+                 src / 1000.0f, l, ref);
+        fail |= check(what, fabs(l - ref) < 0.005);
+    }
+
+    // 30 kHz at 96 kHz would fold to 18 kHz at 48 kHz, which the
+    // resampler then folds again to T_OUT - 18 kHz: the decimator must
+    // stop it (filter off, so nothing downstream would). Measured at that
+    // exact frequency, relative to the tone. The tone is ALIAS_AMP (+36 dB)
+    // so what gets through is well above the 8-bit floor; nothing clips
+    // before the quantizer. Dropping samples instead of filtering leaves
+    // a full-scale alias, clipped to about -39 dB of the tone.
+    cfg.filter = cfg.shape = cfg.dither = false;
+    sine(96000.0f, 30000.0, ALIAS_AMP);
+    int n = render(96000.0f, &cfg, a, 256);
+    double alias_db = 20.0 * log10(level(a, n, T_OUT - 18000.0) / ALIAS_AMP + 1e-12);
+    char what[64];
+    snprintf(what, sizeof(what), "96 kHz: 30 kHz tone, alias at %.0f Hz %.1f dB",
+             T_OUT - 18000.0, alias_db);
+    fail |= check(what, alias_db < ALIAS_DB);
+
+    // detector: 256-frame reads at the link's rate, clock in ns
+    ratedet_t rd;
+    ratedet_init(&rd, 48000);
+    uint64_t t = 1000000000ULL;
+    unsigned got = 0;
+    int reads = 0;
+    for (; reads < 5 * 48000 / 256 && !got; reads++, t += 256 * 1000000000ULL / 48000)
+        got = ratedet_update(&rd, 256, t);
+    bool ok = !got;
+    int switched = 0;
+    for (; switched < 5 * 96000 / 256 && !got; switched++, t += 256 * 1000000000ULL / 96000)
+        got = ratedet_update(&rd, 256, t);
+    double secs = switched * 256.0 / 96000.0;
+    ok = ok && got == 96000 && secs > RATEDET_CONFIRM * RATEDET_WINDOW_MS / 1000.0 - 1.0
+            && secs < (RATEDET_CONFIRM + 1) * RATEDET_WINDOW_MS / 1000.0;
+    snprintf(what, sizeof(what), "detect 48 -> 96 kHz after %.1f s", secs);
+    fail |= check(what, ok);
+
+    fail |= check("snap 47.2k, 44.9k, 46k, 0",
+                  ratedet_snap(47200.0) == 48000 && ratedet_snap(44900.0) == 44100 &&
+                  ratedet_snap(46000.0) == 0 && ratedet_snap(0.0) == 0);
+    return fail;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+
+#include "pico_link.h"
+
+#define PICO_REOPEN_MS 2000     // retry after the Pico goes away
+
+static inline uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+int pico_status_parse(const char *line, pico_status_t *ps)
+{
+    pico_status_t s;
+    int active;
+
+    const char *p = strstr(line, "Ring:");
+    if (!p || sscanf(p, "Ring: %u/%u, STROBE: %f Hz, Under: %lu, Active: %d",
+                     &s.fill, &s.size, &s.strobe_hz, &s.underruns, &active) != 5)
+        return -1;
+    if (s.size == 0 || s.fill >= s.size)
+        return -1;
+    s.active = active != 0;
+    *ps = s;
+    return 0;
+}
+
+void pico_link_init(pico_link_t *pl, float rate)
+{
+    int setpoint = pl->setpoint > 0 ? pl->setpoint : PICO_SETPOINT_DEFAULT;
+    drift_init(&pl->ctl, (float)setpoint, rate);
+    pl->was_active = false;
+
+    seqlock_init(&pl->lock);
+    memset(&pl->v, 0, sizeof(pl->v));
+}
+
+float pico_link_update(pico_link_t *pl, const pico_status_t *ps, float dt,
+                       uint64_t now_ms)
+{
+    float ppm = pl->ctl.ppm;
+    if (ps->active) {
+        // a new session starts wherever the DMA left the ring: filter
+        // from there, keep the integrator (the STROBE error)
+        if (!pl->was_active)
+            pl->ctl.fill_lp = (float)ps->fill;
+        ppm = drift_update(&pl->ctl, (float)ps->fill, dt);
+    }
+    pl->was_active = ps->active;
+
+    seqlock_write_begin(&pl->lock);
+    pl->v.st = *ps;
+    pl->v.pace_ppm = ppm;
+    pl->v.reports++;
+    pl->v.last_ms = now_ms;
+    seqlock_write_end(&pl->lock);
+    return ppm;
+}
+
+// --------------------------------------------------------------------
+// Reader: raw mode on a tty, anything else (a fifo from pico_sim) as is
+// --------------------------------------------------------------------
+static int link_open(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void *pico_link_thread(void *arg)
+{
+    pico_link_t *pl = arg;
+    char line[128];
+    size_t len = 0;
+    uint64_t last = 0;
+    bool warned = false;
+
+    for (;;) {
+        int fd = link_open(pl->tty);
+        if (fd < 0) {
+            // once: the Pico may just not be plugged in yet
+            if (!warned)
+                perror(pl->tty);
+            warned = true;
+            usleep(PICO_REOPEN_MS * 1000);
+            continue;
+        }
+        warned = false;
+        len = 0;
+
+        char buf[256];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR)) {
+            for (ssize_t i = 0; i < n; i++) {
+                if (buf[i] != '\n' && buf[i] != '\r') {
+                    if (len < sizeof(line) - 1)
+                        line[len++] = buf[i];
+                    continue;
+                }
+                line[len] = 0;
+                len = 0;
+
+                pico_status_t ps;
+                if (pico_status_parse(line, &ps) < 0)
+                    continue;
+
+                // first report, or the first after a gap: one nominal period
+                uint64_t t = now_ms();
+                float dt = (last && t - last < PICO_STALE_MS) ? (t - last) / 1000.0f : 1.0f;
+                last = t;
+                pico_link_update(pl, &ps, dt, t);
+            }
+        }
+
+        // unplugged or reset: the device node comes back under the same name
+        close(fd);
+        usleep(PICO_REOPEN_MS * 1000);
+    }
+    return NULL;
+}
+
+int pico_link_thread_create(pthread_t *th, pico_link_t *pl, const rt_thread_cfg_t *rt)
+{
+    return rt_thread_create(th, rt, "pico", pico_link_thread, pl);
+}
@@ -0,0 +1,92 @@
+#ifndef PICO_LINK_H
+#define PICO_LINK_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "drift.h"
+#include "seqlock.h"
+#include "rt.h"
+
+// The Pico's status, read from its USB serial console, and the loop that
+// holds the Pico ring with it.
+//
+// The firmware prints one line a second:
+//
+//   Ring: 1024/8192, STROBE: 28150.0 Hz, Under: 0, Active: 1
+//
+// The SPI sender paces from the Pi clock, so a STROBE running off the
+// Pi's idea of target_rate fills or drains the Pico ring. This loop runs
+// a drift_ctl_t on the reported Pico fill and trims the SPI pacing rate
+// (ppm, + = send slower) to hold it at the setpoint; the Pi ring's drift
+// loop then follows the trimmed drain like any other clock error.
+//
+// The loop only runs while the Amiga strobes (Active: 1): an idle Pico
+// ring is lapped by the DMA and its fill means nothing. Between sessions
+// and when the link goes quiet the last trim stays, it is the measured
+// STROBE error.
+
+typedef struct {
+    unsigned fill;              // Pico ring fill (bytes)
+    unsigned size;              // Pico ring size
+    float strobe_hz;            // STROBE rate over the last second
+    unsigned long underruns;    // ...and underruns in it
+    bool active;                // activity pin
+} pico_status_t;
+
+// Published once per report
+typedef struct {
+    pico_status_t st;           // last report
+    float pace_ppm;             // SPI pacing trim in use
+    uint64_t reports;           // status lines read
+    uint64_t last_ms;           // CLOCK_MONOTONIC of the last one, 0 = none
+} pico_view_t;
+
+typedef struct {
+    const char *tty;            // Pico USB serial, NULL = no link
+    int setpoint;               // Pico fill to hold, 0 = PICO_SETPOINT_DEFAULT
+
+    drift_ctl_t ctl;            // link thread only
+    bool was_active;
+
+    seqlock_t lock;
+    pico_view_t v;
+} pico_link_t;
+
+#define PICO_SETPOINT_DEFAULT 1024
+#define PICO_STALE_MS         3000  // no report for this long: link down
+
+// One status line; returns 0, or -1 if it isn't one (boot messages etc.)
+int pico_status_parse(const char *line, pico_status_t *ps);
+
+// rate: SPI target rate, used to derive loop gains
+void pico_link_init(pico_link_t *pl, float rate);
+
+// Feed one report taken dt seconds after the previous one, at now_ms.
+// Returns the pacing trim in ppm.
+float pico_link_update(pico_link_t *pl, const pico_status_t *ps, float dt,
+                       uint64_t now_ms);
+
+// Non-blocking. Returns true and fills *out with a consistent copy;
+// false if an update was in flight (keep the previous copy).
+static inline bool pico_link_fetch(const pico_link_t *pl, pico_view_t *out)
+{
+    unsigned seq;
+    if (!seqlock_try_read_begin(&pl->lock, &seq))
+        return false;
+
+    pico_view_t tmp;
+    memcpy(&tmp, &pl->v, sizeof(tmp));
+
+    if (!seqlock_try_read_end(&pl->lock, seq))
+        return false;
+
+    *out = tmp;
+    return true;
+}
+
+// Reads pl->tty, reopening it when the Pico is unplugged or reset
+int pico_link_thread_create(pthread_t *th, pico_link_t *pl, const rt_thread_cfg_t *rt);
+
+#endif
@@ -0,0 +1,453 @@
+// Host-side stand-in for the Pico + Amiga: the Pico's DMA ring and
+// strobe_irq() from pico/pico_amiga_sampler.c, fed by the byte stream the
+// Pi would clock into /dev/spidev0.0, drained by a virtual Amiga STROBE.
+//
+//   mkfifo /tmp/spidev /tmp/picotty
+//   ./pico_sim --status /tmp/picotty /tmp/spidev &
+//   ./sampler --test-tone --spi-dev /tmp/spidev --pico-tty /tmp/picotty
+//
+// spi.c falls back to write() when the device isn't a spidev, so the Pi
+// side runs unmodified. Bytes are timestamped on arrival; latency is
+// arrival → STROBE latch, i.e. what the Pico ring adds. Add the Pi ring
+// fill / rate (shown in the sampler UI) for the full Pi → Amiga delay.
+//
+// Like the firmware, the DMA never waits for the reader: a full ring is
+// lapped, and the reader only sees (write - read) mod size. The activity
+// pin follows ACTIVITY_TIMEOUT_US as polled by the firmware's main loop,
+// and --on/--off stop and restart the Amiga to show where the reader
+// resumes. --status writes the firmware's once-a-second USB serial line,
+// which the sampler's Pico link reads to trim its pacing.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+#define SIM_RATE_DEFAULT   28149.96
+#define SIM_RING_DEFAULT   8192        // pico RING_SIZE
+
+#define PICO_ACTIVITY_TIMEOUT_US 3000   // ACTIVITY_TIMEOUT_US
+#define PICO_POLL_MS             100    // firmware main loop sleep
+
+#define LAT_BIN_US   20                // latency histogram resolution
+#define LAT_BINS     4096              // ~82 ms, last bin is overflow
+
+typedef struct {
+    double rate;            // nominal STROBE rate (Hz)
+    double drift_ppm;       // Amiga clock error
+    double jitter_us;       // uniform ±jitter on each strobe edge
+    int ring_size;          // Pico ring, power of two
+    int start_fill;         // Amiga starts strobing at this fill
+    double on_s, off_s;     // Amiga samples on_s, pauses off_s; 0 = always
+    double seconds;         // stop after this long, 0 = at EOF
+    bool csv;               // per-second CSV instead of text
+    const char *status;     // firmware status lines go here, NULL = none
+} sim_opts_t;
+
+// Pico ring: data plus per-byte arrival time and stream position, which
+// the firmware doesn't have but the sim needs to tell what was lost
+typedef struct {
+    uint8_t *buf;
+    uint64_t *arrival_ns;
+    int64_t *seq;           // stream position of the byte in each slot
+    uint32_t mask;
+    uint32_t read_ptr, write_ptr;
+    int64_t written;        // bytes written so far
+    int64_t played;         // stream position of the last byte latched
+    uint8_t last_sample;
+} pico_ring_t;
+
+// ACTIVITY_PIN as the firmware drives it
+typedef struct {
+    bool pin;
+    uint64_t last_strobe_ns;
+    uint64_t next_poll_ns;
+} pico_activity_t;
+
+typedef struct {
+    uint64_t strobes, underruns, overruns, stale, bytes_in, transitions;
+    uint32_t fill_min, fill_max;
+    double fill_sum;
+    uint64_t fill_samples;
+    uint32_t lat_hist[LAT_BINS];
+    uint64_t lat_count;
+    uint64_t lat_max_ns;
+} sim_stats_t;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static uint32_t rng_state = 0x12345678;
+
+static inline float frand(void) {   // 0..1
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline uint32_t ring_fill(const pico_ring_t *r) {
+    return (r->write_ptr - r->read_ptr) & r->mask;
+}
+
+static void stats_reset(sim_stats_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->fill_min = UINT32_MAX;
+}
+
+// --------------------------------------------------------------------
+// DMA side: bytes land in the ring as they arrive. The real DMA ring
+// just wraps and leaves read_ptr alone, so lapping the reader overwrites
+// unplayed bytes (counted as overruns) and makes the ring look as empty
+// as write - read mod size says.
+// --------------------------------------------------------------------
+static void ring_write(pico_ring_t *r, sim_stats_t *s,
+                       const uint8_t *p, int n, uint64_t t)
+{
+    for (int i = 0; i < n; i++) {
+        if (r->seq[r->write_ptr] > r->played)
+            s->overruns++;
+        r->buf[r->write_ptr] = p[i];
+        r->arrival_ns[r->write_ptr] = t;
+        r->seq[r->write_ptr] = r->written++;
+        r->write_ptr = (r->write_ptr + 1) & r->mask;
+    }
+    s->bytes_in += n;
+}
+
+// --------------------------------------------------------------------
+// strobe_irq(): one falling STROBE edge at time t
+// --------------------------------------------------------------------
+static void strobe(pico_ring_t *r, pico_activity_t *a, sim_stats_t *s,
+                   uint64_t t)
+{
+    a->last_strobe_ns = t;
+    if (!a->pin) {
+        a->pin = true;
+        s->transitions++;
+    }
+
+    uint32_t fill = ring_fill(r);
+    if (fill < s->fill_min) s->fill_min = fill;
+    if (fill > s->fill_max) s->fill_max = fill;
+    s->fill_sum += fill;
+    s->fill_samples++;
+
+    if (r->read_ptr == r->write_ptr) {
+        s->underruns++;     // Amiga latches last_sample again
+        return;
+    }
+
+    uint64_t at = r->arrival_ns[r->read_ptr];
+    int64_t seq = r->seq[r->read_ptr];
+    if (seq <= r->played)
+        s->stale++;         // older than what the Amiga already has
+    else
+        r->played = seq;
+    r->last_sample = r->buf[r->read_ptr];
+    r->read_ptr = (r->read_ptr + 1) & r->mask;
+    s->strobes++;
+
+    uint64_t lat = t > at ? t - at : 0;
+    uint32_t bin = (uint32_t)(lat / (LAT_BIN_US * 1000ULL));
+    if (bin >= LAT_BINS) bin = LAT_BINS - 1;
+    s->lat_hist[bin]++;
+    s->lat_count++;
+    if (lat > s->lat_max_ns) s->lat_max_ns = lat;
+}
+
+// --------------------------------------------------------------------
+// main loop: every PICO_POLL_MS, drop the pin once no STROBE has come
+// for ACTIVITY_TIMEOUT_US. Nothing else resyncs: read_ptr stays where
+// the Amiga left it.
+// --------------------------------------------------------------------
+static void activity_poll(pico_activity_t *a, sim_stats_t *s, uint64_t now)
+{
+    while (a->next_poll_ns <= now) {
+        uint64_t t = a->next_poll_ns;
+        if (a->pin && t > a->last_strobe_ns &&
+            t - a->last_strobe_ns > PICO_ACTIVITY_TIMEOUT_US * 1000ULL) {
+            a->pin = false;
+            s->transitions++;
+        }
+        a->next_poll_ns += PICO_POLL_MS * 1000000ULL;
+    }
+}
+
+// fold one reporting interval into the run totals
+static void stats_merge(sim_stats_t *t, const sim_stats_t *s)
+{
+    t->strobes += s->strobes;
+    t->underruns += s->underruns;
+    t->overruns += s->overruns;
+    t->stale += s->stale;
+    t->bytes_in += s->bytes_in;
+    t->transitions += s->transitions;
+    if (s->fill_min < t->fill_min) t->fill_min = s->fill_min;
+    if (s->fill_max > t->fill_max) t->fill_max = s->fill_max;
+    t->fill_sum += s->fill_sum;
+    t->fill_samples += s->fill_samples;
+    for (int i = 0; i < LAT_BINS; i++)
+        t->lat_hist[i] += s->lat_hist[i];
+    t->lat_count += s->lat_count;
+    if (s->lat_max_ns > t->lat_max_ns) t->lat_max_ns = s->lat_max_ns;
+}
+
+static double lat_percentile_ms(const sim_stats_t *s, double p)
+{
+    if (!s->lat_count) return 0.0;
+    uint64_t want = (uint64_t)(p * s->lat_count);
+    uint64_t acc = 0;
+    for (int i = 0; i < LAT_BINS; i++) {
+        acc += s->lat_hist[i];
+        if (acc > want) return (i + 0.5) * LAT_BIN_US / 1000.0;
+    }
+    return LAT_BINS * LAT_BIN_US / 1000.0;
+}
+
+static void report(const sim_opts_t *o, const sim_stats_t *s,
+                   double t_s, double span_s, bool active)
+{
+    double fill_avg = s->fill_samples ? s->fill_sum / s->fill_samples : 0.0;
+    uint32_t fill_min = s->fill_samples ? s->fill_min : 0;
+
+    if (o->csv) {
+        printf("%.1f,%.1f,%llu,%llu,%llu,%llu,%u,%.0f,%u,%.3f,%.3f,%.3f,%d\n",
+               t_s, (s->strobes + s->underruns) / span_s,
+               (unsigned long long)s->bytes_in,
+               (unsigned long long)s->underruns,
+               (unsigned long long)s->overruns,
+               (unsigned long long)s->stale,
+               fill_min, fill_avg, s->fill_max,
+               lat_percentile_ms(s, 0.50), lat_percentile_ms(s, 0.99),
+               s->lat_max_ns / 1e6, active);
+    } else {
+        printf("%7.1fs  STROBE %7.1f Hz  in %6.0f B/s  under %4llu  over %4llu  "
+               "stale %4llu  ring %4u/%5.0f/%4u  lat p50 %6.2f p99 %6.2f "
+               "max %6.2f ms  %s\n",
+               t_s, (s->strobes + s->underruns) / span_s, s->bytes_in / span_s,
+               (unsigned long long)s->underruns,
+               (unsigned long long)s->overruns,
+               (unsigned long long)s->stale,
+               fill_min, fill_avg, s->fill_max,
+               lat_percentile_ms(s, 0.50), lat_percentile_ms(s, 0.99),
+               s->lat_max_ns / 1e6, active ? "active" : "idle");
+    }
+    fflush(stdout);
+}
+
+// --------------------------------------------------------------------
+static void usage(void) {
+    printf(
+        "pico_sim [options] INPUT   (INPUT: fifo, or - for stdin)\n"
+        "  --rate Hz        Amiga STROBE rate (default 28149.96)\n"
+        "  --drift-ppm X    Amiga clock error (default 0)\n"
+        "  --jitter-us X    uniform +/-X us jitter per edge (default 0)\n"
+        "  --ring N         Pico ring size, power of two (default 8192)\n"
+        "  --start-fill N   start strobing at N buffered bytes (default 1)\n"
+        "  --on S           Amiga samples for S seconds at a time (default 0 = always)\n"
+        "  --off S          ...then pauses S seconds (default 1)\n"
+        "  --seconds N      stop after N seconds (a fifo never hits EOF)\n"
+        "  --csv            per-second CSV rows\n"
+        "  --status PATH    firmware status line each second (fifo for --pico-tty)\n"
+    );
+    exit(0);
+}
+
+int main(int argc, char **argv)
+{
+    sim_opts_t o = {
+        .rate = SIM_RATE_DEFAULT, .ring_size = SIM_RING_DEFAULT, .start_fill = 1,
+        .off_s = 1.0,
+    };
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--rate") && i+1 < argc)
+            o.rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--drift-ppm") && i+1 < argc)
+            o.drift_ppm = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter-us") && i+1 < argc)
+            o.jitter_us = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--ring") && i+1 < argc)
+            o.ring_size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--start-fill") && i+1 < argc)
+            o.start_fill = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--on") && i+1 < argc)
+            o.on_s = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--off") && i+1 < argc)
+            o.off_s = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i+1 < argc)
+            o.seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--csv"))
+            o.csv = true;
+        else if (!strcmp(argv[i], "--status") && i+1 < argc)
+            o.status = argv[++i];
+        else if (!path && argv[i][0] != '-')
+            path = argv[i];
+        else if (!path && !strcmp(argv[i], "-"))
+            path = argv[i];
+        else
+            usage();
+    }
+
+    if (!path || o.rate <= 0.0 || o.ring_size < 2 ||
+        (o.ring_size & (o.ring_size - 1)))
+        usage();
+    if (o.start_fill < 1) o.start_fill = 1;
+    if (o.start_fill >= o.ring_size) o.start_fill = o.ring_size - 1;
+
+    // O_RDWR on a fifo: never see EOF when the sampler restarts
+    int fd = !strcmp(path, "-") ? 0 : open(path, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // status lines only while someone reads them, as over USB: a fifo
+    // doesn't open for writing without a reader, and a reader that goes
+    // away gets reopened for
+    int status_fd = -1;
+    signal(SIGPIPE, SIG_IGN);
+
+    pico_ring_t ring = {
+        .buf = malloc(o.ring_size),
+        .arrival_ns = malloc(o.ring_size * sizeof(uint64_t)),
+        .seq = malloc(o.ring_size * sizeof(int64_t)),
+        .mask = o.ring_size - 1,
+        .played = -1,
+        .last_sample = 0x80,
+    };
+    static sim_stats_t sec, total;
+    if (!ring.buf || !ring.arrival_ns || !ring.seq) {
+        perror("malloc");
+        return 1;
+    }
+    memset(ring.buf, 0x80, o.ring_size);
+    for (int i = 0; i < o.ring_size; i++)
+        ring.seq[i] = -1;   // the firmware's silence pre-fill, never played
+    stats_reset(&sec);
+    stats_reset(&total);
+
+    if (o.csv)
+        printf("t_s,strobe_hz,bytes_in,underruns,overruns,"
+               "stale,fill_min,fill_avg,fill_max,lat_p50_ms,lat_p99_ms,lat_max_ms,active\n");
+
+    const double period_ns = 1e9 / (o.rate * (1.0 + o.drift_ppm * 1e-6));
+    const double jitter_ns = o.jitter_us * 1000.0;
+
+    uint64_t t0 = now_ns();
+    uint64_t last_report = t0;
+    double next_edge = 0.0;         // ideal time of the next edge, ns
+    bool started = false, amiga = false, eof = false;
+    uint64_t session_end = 0;       // when the Amiga stops or restarts
+    pico_activity_t act = { .next_poll_ns = t0 + PICO_POLL_MS * 1000000ULL };
+    uint8_t buf[4096];
+
+    for (;;) {
+        uint64_t now = now_ns();
+
+        // --- Amiga: every STROBE edge that is due, each at its own time.
+        // Edges run before the read below, so they only see bytes that had
+        // arrived by the previous pass. ---
+        if (amiga) {
+            double stop = o.on_s > 0.0 ? (double)session_end : (double)now;
+            if (stop > (double)now) stop = (double)now;
+            while (next_edge <= stop) {
+                double j = jitter_ns ? (frand() * 2.0 - 1.0) * jitter_ns : 0.0;
+                uint64_t t = (uint64_t)(next_edge + j);
+                strobe(&ring, &act, &sec, t);
+                next_edge += period_ns;
+            }
+        }
+        if (o.on_s > 0.0 && started && now >= session_end) {
+            amiga = !amiga;
+            session_end += (uint64_t)((amiga ? o.on_s : o.off_s) * 1e9);
+            next_edge = (double)now;
+        }
+        activity_poll(&act, &sec, now);
+        if (eof && ring_fill(&ring) == 0)
+            break;
+        if (o.seconds > 0.0 && now - t0 >= (uint64_t)(o.seconds * 1e9))
+            break;
+
+        // --- SPI/DMA: whatever arrived since the last pass ---
+        if (!eof) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                ring_write(&ring, &sec, buf, (int)n, now);
+            } else if (n == 0) {
+                eof = true;
+            } else if (errno != EAGAIN && errno != EINTR) {
+                perror("read");
+                break;
+            }
+        }
+
+        if (!started && ring_fill(&ring) >= (uint32_t)o.start_fill) {
+            started = amiga = true;
+            next_edge = (double)now;
+            session_end = now + (uint64_t)(o.on_s * 1e9);
+        }
+
+        if (now - last_report >= 1000000000ULL) {
+            report(&o, &sec, (now - t0) / 1e9, (now - last_report) / 1e9, act.pin);
+            if (o.status && status_fd < 0)
+                status_fd = open(o.status, O_WRONLY | O_NONBLOCK);
+            if (status_fd >= 0 &&
+                dprintf(status_fd, "Ring: %u/%d, STROBE: %.1f Hz, Under: %llu, Active: %d\n",
+                        ring_fill(&ring), o.ring_size,
+                        (sec.strobes + sec.underruns) / ((now - last_report) / 1e9),
+                        (unsigned long long)sec.underruns, act.pin) < 0) {
+                close(status_fd);
+                status_fd = -1;
+            }
+            stats_merge(&total, &sec);
+            stats_reset(&sec);
+            last_report = now;
+        }
+
+        // Edges carry their own timestamps, so they can be run in
+        // batches; only arrivals need a prompt wakeup to be stamped right.
+        if (!eof) {
+            struct pollfd pfd = { .fd = fd, .events = POLLIN };
+            poll(&pfd, 1, 1);
+        } else {
+            struct timespec ts = { 0, 1000000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    // summary
+    stats_merge(&total, &sec);
+    double span = (now_ns() - t0) / 1e9;
+    if (!o.csv) {
+        printf("total %.1fs: %llu bytes in, %llu strobes, %llu underruns, "
+               "%llu overruns, %llu stale, %llu activity edges\n", span,
+               (unsigned long long)total.bytes_in,
+               (unsigned long long)(total.strobes + total.underruns),
+               (unsigned long long)total.underruns,
+               (unsigned long long)total.overruns,
+               (unsigned long long)total.stale,
+               (unsigned long long)total.transitions);
+        printf("ring fill %u..%u (mean %.0f), latency p50 %.2f p99 %.2f "
+               "max %.2f ms\n",
+               total.fill_samples ? total.fill_min : 0, total.fill_max,
+               total.fill_samples ? total.fill_sum / total.fill_samples : 0.0,
+               lat_percentile_ms(&total, 0.50), lat_percentile_ms(&total, 0.99),
+               total.lat_max_ns / 1e6);
+    }
+
+    return total.underruns ? 2 : 0;
+}
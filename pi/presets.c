@@ -17,13 +17,14 @@ static const preset_t PRESETS[] = {
         .saturate = false
     },
 
-    // 1 — RAW + SAT
+    // 1 — RAW + SAT (nothing filters the harmonics afterwards)
     { "Raw + Saturation", 
         .filter = false, 
         .shape = false,
         .dither = false,
         .compress = false,
-        .saturate = true
+        .saturate = true,
+        .oversample = 4
     },
 
     // 2 — FILTER ONLY (clean 14 kHz LPF)
@@ -68,7 +69,8 @@ static const preset_t PRESETS[] = {
         .shape = false,
         .dither = false,
         .compress = true,
-        .saturate = true
+        .saturate = true,
+        .oversample = 2
     },
 
     // 7 — CLEAN + COMP (pro-audio mode)
@@ -109,4 +111,5 @@ void preset_apply(int index, dsp_config_t *cfg)
     cfg->dither   = p->dither;
     cfg->compress = p->compress;
     cfg->saturate = p->saturate;
+    cfg->oversample = p->oversample ? p->oversample : 1;
 }
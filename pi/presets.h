@@ -12,6 +12,7 @@ typedef struct {
     bool dither;
     bool compress;
     bool saturate;
+    int oversample;     // around compress/saturate, 0 = 1x
 } preset_t;
 
 // Accessors
@@ -0,0 +1,50 @@
+#include "ratedet.h"
+#include <math.h>
+
+static const unsigned std_rates[] = {
+    32000, 44100, 48000, 64000, 88200, 96000, 128000, 176400, 192000,
+};
+
+unsigned ratedet_snap(double hz)
+{
+    for (unsigned i = 0; i < sizeof(std_rates) / sizeof(std_rates[0]); i++)
+        if (fabs(hz - std_rates[i]) <= std_rates[i] * RATEDET_TOLERANCE)
+            return std_rates[i];
+    return 0;
+}
+
+void ratedet_init(ratedet_t *rd, unsigned rate)
+{
+    *rd = (ratedet_t){ .rate = rate };
+}
+
+unsigned ratedet_update(ratedet_t *rd, int frames, uint64_t now_ns)
+{
+    // the first read's frames were captured before it: the window starts
+    // after them
+    if (!rd->t0) {
+        rd->t0 = now_ns;
+        return 0;
+    }
+
+    rd->frames += frames;
+    uint64_t dt = now_ns - rd->t0;
+    if (dt < (uint64_t)RATEDET_WINDOW_MS * 1000000ULL)
+        return 0;
+
+    rd->measured = rd->frames * 1e9 / (double)dt;
+    rd->t0 = now_ns;
+    rd->frames = 0;
+
+    unsigned r = ratedet_snap(rd->measured);
+    if (!r || r == rd->rate) {
+        rd->candidate = 0;
+        rd->agree = 0;
+        return 0;
+    }
+    if (r != rd->candidate) {
+        rd->candidate = r;
+        rd->agree = 0;
+    }
+    return ++rd->agree >= RATEDET_CONFIRM ? r : 0;
+}
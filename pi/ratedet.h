@@ -0,0 +1,36 @@
+#ifndef RATEDET_H
+#define RATEDET_H
+
+#include <stdint.h>
+
+// Source rate detection for --alsa-rate auto.
+//
+// A receiver slaved to the S/PDIF link delivers frames at the link's rate
+// whatever hw_params said, so the frame count against CLOCK_MONOTONIC
+// gives the source rate: a player switching from 48 to 96 kHz shows up as
+// twice the frames per second. Each window's measurement snaps to the
+// nearest standard rate; a change is reported once RATEDET_CONFIRM
+// windows in a row agree on it, and the audio thread reopens the stream.
+#define RATEDET_WINDOW_MS 1000
+#define RATEDET_CONFIRM   2
+#define RATEDET_TOLERANCE 0.03      // +-3 %: standard rates are >= 8 % apart
+
+typedef struct {
+    unsigned rate;          // the stream's rate
+    uint64_t t0;            // window start, 0 = first read not seen yet
+    uint64_t frames;        // captured since t0
+    unsigned candidate;     // a different rate the last windows measured
+    int agree;              // ...how many in a row
+    double measured;        // last window, Hz (for the UI)
+} ratedet_t;
+
+void ratedet_init(ratedet_t *rd, unsigned rate);
+
+// frames read at now_ns. Returns the rate to reopen at, else 0.
+unsigned ratedet_update(ratedet_t *rd, int frames, uint64_t now_ns);
+
+// nearest of 32k, 44.1k, 48k and their 2x/4x within RATEDET_TOLERANCE,
+// 0 if none (no link, stalled stream)
+unsigned ratedet_snap(double hz);
+
+#endif
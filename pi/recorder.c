@@ -0,0 +1,300 @@
+#include "recorder.h"
+#include "rice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// One encoded stream: samples collect into a block, blocks are coded into
+// an aligned staging buffer, and the buffer goes out REC_WRITE_SIZE at a
+// time so the card sees few, large writes.
+typedef struct {
+    int fd;
+    int bits;                   // 8 or 24
+    ringbuf_t *q;
+    int32_t block[RICE_BLOCK];
+    int nblock;
+    uint8_t *stage;             // REC_STAGE bytes, page aligned
+    size_t nstage;
+    bool rate_pending;          // header rate comes with the first samples
+} rec_stream_t;
+
+#define REC_STAGE (REC_WRITE_SIZE + RICE_MAX_BYTES(RICE_BLOCK))
+
+static uint8_t *alloc_queue(uint32_t size)
+{
+    void *p = NULL;
+    if (posix_memalign(&p, 4096, size) != 0)
+        return NULL;
+    return p;
+}
+
+int recorder_init(recorder_t *r, const recorder_cfg_t *cfg)
+{
+    memset(r, 0, sizeof(*r));
+    r->cfg = *cfg;
+
+    uint8_t *out = alloc_queue(REC_OUT_QUEUE);
+    if (!out || ringbuf_init_buf(&r->out_q, out, REC_OUT_QUEUE) < 0)
+        return -1;
+
+    if (cfg->record_input) {
+        uint8_t *in = alloc_queue(REC_IN_QUEUE);
+        if (!in || ringbuf_init_buf(&r->in_q, in, REC_IN_QUEUE) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// Writing
+// --------------------------------------------------------------------
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void stage_write(recorder_t *r, rec_stream_t *s, size_t n)
+{
+    const uint8_t *p = s->stage;
+    size_t left = n;
+    while (left > 0) {
+        ssize_t w = write(s->fd, p, left);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            atomic_store_explicit(&r->error, errno, memory_order_relaxed);
+            break;  // keep recording, the pass file is short
+        }
+        p += w;
+        left -= (size_t)w;
+    }
+    atomic_fetch_add_explicit(&r->disk_bytes, n - left, memory_order_relaxed);
+
+    memmove(s->stage, s->stage + n, s->nstage - n);
+    s->nstage -= n;
+}
+
+static void flush_block(recorder_t *r, rec_stream_t *s)
+{
+    if (s->nblock == 0) return;
+
+    s->nstage += rice_encode_block(s->block, s->nblock, s->stage + s->nstage);
+    s->nblock = 0;
+
+    if (s->nstage >= REC_WRITE_SIZE)
+        stage_write(r, s, REC_WRITE_SIZE);
+}
+
+// Move everything queued into the stream's blocks
+static void drain(recorder_t *r, rec_stream_t *s)
+{
+    uint8_t buf[3 * 1024];
+    int bps = s->bits / 8;
+
+    for (;;) {
+        uint32_t got = ringbuf_pop_bulk(s->q, buf, sizeof(buf));
+        got -= got % bps;   // only ever whole samples are queued
+        if (got == 0) break;
+
+        if (s->fd < 0) continue;    // between passes: straggler bytes
+        atomic_fetch_add_explicit(&r->raw_bytes, got, memory_order_relaxed);
+
+        // still in the stage buffer: nothing is written before 64 KB
+        if (s->rate_pending) {
+            unsigned rate = atomic_load_explicit(&r->in_rate, memory_order_acquire);
+            put_le32(s->stage + 8, rate * 1000u);
+            s->rate_pending = false;
+        }
+
+        for (uint32_t i = 0; i < got; i += bps) {
+            int32_t v;
+            if (bps == 1)
+                v = buf[i];
+            else    // s24le, sign-extended
+                v = (int32_t)((uint32_t)buf[i] << 8 | (uint32_t)buf[i + 1] << 16 |
+                              (uint32_t)buf[i + 2] << 24) >> 8;
+
+            s->block[s->nblock++] = v;
+            if (s->nblock == RICE_BLOCK)
+                flush_block(r, s);
+        }
+    }
+}
+
+static int stream_open(recorder_t *r, rec_stream_t *s, const char *stamp,
+                       const char *tag, float rate)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/pass-%s-%s.srec", r->cfg.dir, stamp, tag);
+
+    s->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (s->fd < 0) {
+        atomic_store_explicit(&r->error, errno, memory_order_relaxed);
+        return -1;
+    }
+
+    uint8_t *h = s->stage;
+    memset(h, 0, REC_HDR);
+    memcpy(h, REC_MAGIC, 4);
+    h[4] = REC_VERSION;
+    h[5] = (uint8_t)s->bits;
+    put_le32(h + 8, (uint32_t)lrintf(rate * 1000.0f));
+    s->nstage = REC_HDR;
+    s->nblock = 0;
+    s->rate_pending = rate == 0.0f;
+    return 0;
+}
+
+static void stream_close(recorder_t *r, rec_stream_t *s)
+{
+    if (s->fd < 0) return;
+
+    flush_block(r, s);
+    while (s->nstage > 0)
+        stage_write(r, s, s->nstage > REC_WRITE_SIZE ? REC_WRITE_SIZE : s->nstage);
+    close(s->fd);
+    s->fd = -1;
+}
+
+// The queues already hold the pass from its first block (the producers
+// armed themselves), so nothing queued is discarded here.
+static void pass_open(recorder_t *r, rec_stream_t *st, int n)
+{
+    char base[32], stamp[48];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm;
+    localtime_r(&ts.tv_sec, &tm);
+    size_t len = strftime(base, sizeof(base), "%Y%m%d-%H%M%S", &tm);
+    snprintf(base + len, sizeof(base) - len, "-%03ld", ts.tv_nsec / 1000000);
+
+    // O_EXCL: a name taken by an earlier pass (clock stepped back) gets
+    // the next free suffix, checked on the out file the in file pairs with
+    snprintf(stamp, sizeof(stamp), "%s", base);
+    for (int k = 2; stream_open(r, &st[0], stamp, "out", r->cfg.out_rate) < 0; k++) {
+        if (errno != EEXIST || k > 99)
+            break;
+        snprintf(stamp, sizeof(stamp), "%s-%d", base, k);
+    }
+    if (n > 1)
+        stream_open(r, &st[1], stamp, "in", 0.0f);  // rate from the audio thread
+
+    atomic_fetch_add_explicit(&r->passes, 1, memory_order_relaxed);
+    atomic_store_explicit(&r->armed, true, memory_order_release);
+}
+
+static void pass_close(recorder_t *r, rec_stream_t *st, int n)
+{
+    atomic_store_explicit(&r->armed, false, memory_order_release);
+    for (int i = 0; i < n; i++) {
+        drain(r, &st[i]);
+        stream_close(r, &st[i]);
+    }
+    atomic_store_explicit(&r->in_rate, 0, memory_order_relaxed);
+}
+
+static void *recorder_thread(void *arg)
+{
+    recorder_t *r = arg;
+
+    static rec_stream_t st[2];
+    int n = r->cfg.record_input ? 2 : 1;
+    st[0] = (rec_stream_t){ .fd = -1, .bits = 8,  .q = &r->out_q };
+    st[1] = (rec_stream_t){ .fd = -1, .bits = 24, .q = &r->in_q };
+    for (int i = 0; i < n; i++) {
+        void *p;
+        if (posix_memalign(&p, 4096, REC_STAGE) != 0) {
+            atomic_store_explicit(&r->error, ENOMEM, memory_order_relaxed);
+            return NULL;
+        }
+        st[i].stage = p;
+    }
+
+    bool open = false;
+    for (;;) {
+        usleep(REC_POLL_MS * 1000);
+
+        bool active = *r->cfg.active;
+        if (active && !open) {
+            pass_open(r, st, n);
+            open = true;
+        } else if (!active && open) {
+            pass_close(r, st, n);
+            open = false;
+        } else if (open) {
+            for (int i = 0; i < n; i++)
+                drain(r, &st[i]);
+        }
+    }
+    return NULL;
+}
+
+int recorder_thread_create(pthread_t *th, recorder_t *r, const rt_thread_cfg_t *rt)
+{
+    return rt_thread_create(th, rt, "record", recorder_thread, r);
+}
+
+// --------------------------------------------------------------------
+// Offline decode
+// --------------------------------------------------------------------
+int recorder_decode(const char *in, const char *out)
+{
+    FILE *f = fopen(in, "rb");
+    if (!f) { perror(in); return -1; }
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = len > 0 ? malloc(len) : NULL;
+    if (!data || fread(data, 1, len, f) != (size_t)len) {
+        fprintf(stderr, "%s: read failed\n", in);
+        fclose(f);
+        free(data);
+        return -1;
+    }
+    fclose(f);
+
+    if (len < REC_HDR || memcmp(data, REC_MAGIC, 4) || data[4] != REC_VERSION ||
+        (data[5] != 8 && data[5] != 24)) {
+        fprintf(stderr, "%s: not a recorder file\n", in);
+        free(data);
+        return -1;
+    }
+    int bits = data[5];
+
+    FILE *o = fopen(out, "wb");
+    if (!o) { perror(out); free(data); return -1; }
+
+    static int32_t x[RICE_BLOCK];
+    uint8_t buf[3 * RICE_BLOCK];
+    size_t pos = REC_HDR;
+    int rc = 0;
+    while (pos < (size_t)len) {
+        int n;
+        size_t used = rice_decode_block(data + pos, len - pos, x, &n);
+        if (!used) {
+            fprintf(stderr, "%s: corrupt block at offset %zu\n", in, pos);
+            rc = -1;
+            break;
+        }
+        pos += used;
+
+        size_t nb = 0;
+        for (int i = 0; i < n; i++) {
+            buf[nb++] = (uint8_t)x[i];
+            if (bits == 24) {
+                buf[nb++] = (uint8_t)(x[i] >> 8);
+                buf[nb++] = (uint8_t)(x[i] >> 16);
+            }
+        }
+        fwrite(buf, 1, nb, o);
+    }
+
+    free(data);
+    if (fclose(o) != 0) rc = -1;
+    return rc;
+}
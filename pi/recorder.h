@@ -0,0 +1,126 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ringbuf.h"
+#include "rt.h"
+
+// Session recorder. While the Pico holds the activity line up, the exact
+// 8-bit stream the SPI sender writes (and optionally the pre-DSP input at
+// 24 bits) is saved to DIR, one timestamped file per Amiga sampling pass:
+//
+//   DIR/pass-YYYYmmdd-HHMMSS-mmm-out.srec    8-bit stream as sent
+//   DIR/pass-YYYYmmdd-HHMMSS-mmm-in.srec     24-bit input (--record-input)
+//
+// Existing files are never replaced; a clash gets a -2, -3... suffix.
+// An input file is at the rate its first block was captured at; blocks
+// after a rate change (--alsa-rate auto) are left out of that pass.
+//
+// The audio and SPI threads only memcpy into an SPSC queue, and only while
+// the activity line is up: they follow it themselves, so a pass starts with
+// the first block after the line rises rather than at the writer's next
+// poll. A low-priority writer thread drains the queues, Rice-codes them
+// (rice.h) and writes 64 KB aligned chunks. A full queue drops bytes and
+// counts them; it never blocks the producer. `sampler --rec-decode IN OUT`
+// gets the raw stream back (unsigned 8-bit or s24le).
+//
+// File: 16-byte header, then rice.h blocks to the end.
+//   "SREC" u8 version u8 bits u16 reserved u32 rate_mhz u32 reserved
+
+#define REC_MAGIC        "SREC"
+#define REC_VERSION      1
+#define REC_HDR          16
+#define REC_OUT_QUEUE    (64 * 1024)     // 2.3 s at 28 kHz
+#define REC_IN_QUEUE     (512 * 1024)    // 3.6 s of 24-bit at 48 kHz
+#define REC_WRITE_SIZE   (64 * 1024)     // write() granularity
+#define REC_POLL_MS      20
+
+typedef struct {
+    const char *dir;
+    bool record_input;          // also keep the 24-bit pre-DSP input
+    const bool *active;         // Pico activity line (first instance)
+    float out_rate;             // Amiga rate, for the file header
+} recorder_cfg_t;
+
+typedef struct {
+    recorder_cfg_t cfg;
+    ringbuf_t out_q;            // SPI thread -> writer
+    ringbuf_t in_q;             // audio thread -> writer (record_input)
+
+    atomic_bool armed;          // a pass file is open
+    atomic_ulong dropped;       // bytes lost to a full queue
+    atomic_ulong passes;        // files opened
+    atomic_ulong raw_bytes;     // stream bytes recorded
+    atomic_ulong disk_bytes;    // encoded bytes written
+    atomic_int error;           // last errno from open/write, 0 = ok
+    atomic_uint in_rate;        // rate of this pass's input, 0 = none yet
+} recorder_t;
+
+// Allocates the queues. Returns 0 or -1.
+int recorder_init(recorder_t *r, const recorder_cfg_t *cfg);
+
+int recorder_thread_create(pthread_t *th, recorder_t *r, const rt_thread_cfg_t *rt);
+
+// Decode an .srec file to raw samples. Returns 0 or -1.
+int recorder_decode(const char *in, const char *out);
+
+// --------------------------------------------------------------------
+// Producer side: lock-free, no syscalls; r may be NULL (recording off)
+// --------------------------------------------------------------------
+static inline void recorder_push_out(recorder_t *r, const uint8_t *p, uint32_t n)
+{
+    if (!r || !*r->cfg.active)
+        return;
+
+    uint32_t got = ringbuf_push_bulk(&r->out_q, p, n);
+    if (got < n)
+        atomic_fetch_add_explicit(&r->dropped, n - got, memory_order_relaxed);
+}
+
+// Mono float input, +-1.0 full scale, stored as packed s24le; rate is
+// what it was captured at
+static inline void recorder_push_in(recorder_t *r, const float *x, int n,
+                                    unsigned rate)
+{
+    if (!r || !r->cfg.record_input || !*r->cfg.active)
+        return;
+
+    // the pass's first block sets the file's rate (stored before the
+    // samples are queued, so the writer sees it with them)
+    unsigned pass_rate = atomic_load_explicit(&r->in_rate, memory_order_relaxed);
+    if (!pass_rate) {
+        atomic_store_explicit(&r->in_rate, rate, memory_order_release);
+    } else if (pass_rate != rate) {
+        atomic_fetch_add_explicit(&r->dropped, 3 * (uint32_t)n, memory_order_relaxed);
+        return;
+    }
+
+    uint8_t b[3 * 256];
+    while (n > 0) {
+        int c = n < 256 ? n : 256;
+        for (int i = 0; i < c; i++) {
+            float v = x[i] * 8388608.0f;
+            if (v > 8388607.0f) v = 8388607.0f;
+            if (v < -8388608.0f) v = -8388608.0f;
+            int32_t s = (int32_t)lrintf(v);
+            b[3 * i]     = (uint8_t)s;
+            b[3 * i + 1] = (uint8_t)(s >> 8);
+            b[3 * i + 2] = (uint8_t)(s >> 16);
+        }
+        uint32_t want = 3 * c;
+        if (ringbuf_space(&r->in_q) < want) {
+            // whole samples only, or the stream would misalign
+            atomic_fetch_add_explicit(&r->dropped, 3 * (uint32_t)n, memory_order_relaxed);
+            return;
+        }
+        ringbuf_push_bulk(&r->in_q, b, want);
+        x += c;
+        n -= c;
+    }
+}
+
+#endif
@@ -0,0 +1,486 @@
+#define _GNU_SOURCE
+#include "render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define RENDER_BLOCK 4096   // frames per dsp_process_block call
+#define RENDER_RAW   (RENDER_BLOCK * 8 * 4)  // up to 8ch x 32-bit per block
+
+// Per-worker state: every worker owns its own DSP pipeline
+typedef struct {
+    dsp_state_t dsp;
+    float in[RENDER_BLOCK];
+    uint8_t raw[RENDER_RAW];
+} render_ctx_t;
+
+// --------------------------------------------------------------------
+// WAV reader
+// --------------------------------------------------------------------
+typedef struct {
+    FILE *f;
+    int format;             // 1 = PCM, 3 = IEEE float
+    int channels;
+    int bits;
+    int rate;
+    uint32_t frames_left;
+} wav_in_t;
+
+static uint32_t rd_le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t rd_le16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static int wav_open(wav_in_t *w, const char *path)
+{
+    uint8_t hdr[12], ck[8], fmt[40];
+    bool have_fmt = false;
+
+    w->f = fopen(path, "rb");
+    if (!w->f) {
+        perror(path);
+        return -1;
+    }
+
+    if (fread(hdr, 1, 12, w->f) != 12 ||
+        memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4))
+        goto bad;
+
+    while (fread(ck, 1, 8, w->f) == 8) {
+        uint32_t len = rd_le32(ck + 4);
+
+        if (!memcmp(ck, "fmt ", 4)) {
+            uint32_t n = len < sizeof(fmt) ? len : sizeof(fmt);
+            if (len < 16 || fread(fmt, 1, n, w->f) != n)
+                goto bad;
+            fseek(w->f, (len - n) + (len & 1), SEEK_CUR);
+
+            w->format   = rd_le16(fmt);
+            w->channels = rd_le16(fmt + 2);
+            w->rate     = rd_le32(fmt + 4);
+            w->bits     = rd_le16(fmt + 14);
+            if (w->format == 0xFFFE && n >= 26)     // WAVE_FORMAT_EXTENSIBLE
+                w->format = rd_le16(fmt + 24);
+            have_fmt = true;
+        } else if (!memcmp(ck, "data", 4)) {
+            if (!have_fmt || w->channels < 1)
+                goto bad;
+            bool pcm = w->format == 1 &&
+                (w->bits == 8 || w->bits == 16 || w->bits == 24 || w->bits == 32);
+            bool flt = w->format == 3 && w->bits == 32;
+            if (!pcm && !flt) {
+                fprintf(stderr, "%s: unsupported WAV format %d/%d-bit\n",
+                        path, w->format, w->bits);
+                fclose(w->f);
+                return -1;
+            }
+            if (w->rate <= 0) {
+                fprintf(stderr, "%s: bad sample rate %d\n", path, w->rate);
+                fclose(w->f);
+                return -1;
+            }
+
+            // the length can't be trusted (0xFFFFFFFF from streaming
+            // writers, truncated files): no more than the file holds
+            long here = ftell(w->f);
+            if (here < 0 || fseek(w->f, 0, SEEK_END) < 0)
+                goto bad;
+            long end = ftell(w->f);
+            if (end < 0 || fseek(w->f, here, SEEK_SET) < 0)
+                goto bad;
+            if ((uint64_t)len > (uint64_t)(end - here))
+                len = (uint32_t)(end - here);
+
+            w->frames_left = len / (w->channels * (w->bits / 8));
+            return 0;
+        } else {
+            fseek(w->f, len + (len & 1), SEEK_CUR);
+        }
+    }
+
+bad:
+    fprintf(stderr, "%s: not a usable WAV file\n", path);
+    fclose(w->f);
+    return -1;
+}
+
+// Reads up to n frames, downmixed to mono the same way live capture is.
+static int wav_read(wav_in_t *w, uint8_t *raw, float *dst, int n, float gain)
+{
+    int bps = w->bits / 8;
+    int frame_bytes = bps * w->channels;
+    int max = RENDER_RAW / frame_bytes;
+    if (n > max) n = max;
+    if ((uint32_t)n > w->frames_left) n = (int)w->frames_left;
+
+    int got = (int)fread(raw, frame_bytes, n, w->f);
+    w->frames_left -= got;
+
+    float scale = gain / (float)w->channels;
+
+    for (int i = 0; i < got; i++) {
+        const uint8_t *p = raw + i * frame_bytes;
+        float acc = 0.0f;
+
+        for (int c = 0; c < w->channels; c++, p += bps) {
+            float v;
+            if (w->format == 3) {
+                uint32_t u = rd_le32(p);
+                memcpy(&v, &u, 4);
+            } else if (bps == 1) {
+                v = (p[0] - 128) / 128.0f;
+            } else if (bps == 2) {
+                v = (int16_t)rd_le16(p) / 32768.0f;
+            } else if (bps == 3) {
+                int32_t s = p[0] | (p[1] << 8) | (p[2] << 16);
+                if (s & 0x800000) s |= 0xFF000000;
+                v = s / 8388608.0f;
+            } else {
+                v = (int32_t)rd_le32(p) / 2147483648.0f;
+            }
+            acc += v;
+        }
+        dst[i] = acc * scale;
+    }
+    return got;
+}
+
+// --------------------------------------------------------------------
+// Output writers
+// --------------------------------------------------------------------
+typedef enum { OUT_RAW, OUT_8SVX, OUT_WAV } out_fmt_t;
+
+static int out_format(const char *path, out_fmt_t *fmt)
+{
+    const char *ext = strrchr(path, '.');
+    if (!ext) return -1;
+    if (!strcasecmp(ext, ".raw"))  { *fmt = OUT_RAW;  return 0; }
+    if (!strcasecmp(ext, ".8svx") || !strcasecmp(ext, ".iff"))
+                                   { *fmt = OUT_8SVX; return 0; }
+    if (!strcasecmp(ext, ".wav"))  { *fmt = OUT_WAV;  return 0; }
+    return -1;
+}
+
+static void put_be32(FILE *f, uint32_t v) {
+    uint8_t b[4] = { v >> 24, v >> 16, v >> 8, v };
+    fwrite(b, 1, 4, f);
+}
+
+static void put_be16(FILE *f, uint16_t v) {
+    uint8_t b[2] = { v >> 8, v };
+    fwrite(b, 1, 2, f);
+}
+
+static void put_le32(FILE *f, uint32_t v) {
+    uint8_t b[4] = { v, v >> 8, v >> 16, v >> 24 };
+    fwrite(b, 1, 4, f);
+}
+
+static void put_le16(FILE *f, uint16_t v) {
+    uint8_t b[2] = { v, v >> 8 };
+    fwrite(b, 1, 2, f);
+}
+
+// data is the unsigned stream the Pico would put on the parallel port
+static int write_output(const char *path, out_fmt_t fmt,
+                        uint8_t *data, uint32_t len, float rate)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    uint16_t hz = (uint16_t)(rate + 0.5f);
+
+    switch (fmt) {
+    case OUT_RAW:
+        for (uint32_t i = 0; i < len; i++) data[i] ^= 0x80;  // → signed
+        fwrite(data, 1, len, f);
+        break;
+
+    case OUT_8SVX:
+        for (uint32_t i = 0; i < len; i++) data[i] ^= 0x80;  // → signed
+        fwrite("FORM", 1, 4, f);
+        put_be32(f, 4 + (8 + 20) + 8 + len + (len & 1));
+        fwrite("8SVX", 1, 4, f);
+        fwrite("VHDR", 1, 4, f);
+        put_be32(f, 20);
+        put_be32(f, len);           // oneShotHiSamples
+        put_be32(f, 0);             // repeatHiSamples
+        put_be32(f, 0);             // samplesPerHiCycle
+        put_be16(f, hz);            // samplesPerSec
+        fputc(1, f);                // ctOctave
+        fputc(0, f);                // sCompression: none
+        put_be32(f, 0x10000);       // volume: 1.0 (16.16)
+        fwrite("BODY", 1, 4, f);
+        put_be32(f, len);
+        fwrite(data, 1, len, f);
+        if (len & 1) fputc(0, f);
+        break;
+
+    case OUT_WAV:
+        fwrite("RIFF", 1, 4, f);
+        put_le32(f, 4 + (8 + 16) + 8 + len + (len & 1));
+        fwrite("WAVEfmt ", 1, 8, f);
+        put_le32(f, 16);
+        put_le16(f, 1);             // PCM
+        put_le16(f, 1);             // mono
+        put_le32(f, hz);
+        put_le32(f, hz);            // byte rate
+        put_le16(f, 1);             // block align
+        put_le16(f, 8);
+        fwrite("data", 1, 4, f);
+        put_le32(f, len);
+        fwrite(data, 1, len, f);
+        if (len & 1) fputc(0, f);
+        break;
+    }
+
+    if (fclose(f) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// Single file
+// --------------------------------------------------------------------
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static int render_file(render_ctx_t *ctx, const char *in, const char *out,
+                       const render_opts_t *ro)
+{
+    const dsp_config_t *cfg = &ro->cfg;
+    out_fmt_t fmt;
+    if (out_format(out, &fmt) < 0) {
+        fprintf(stderr, "%s: output must end in .raw, .8svx or .wav\n", out);
+        return -1;
+    }
+
+    wav_in_t w = { 0 };
+    if (wav_open(&w, in) < 0)
+        return -1;
+
+    uint64_t t0 = now_ns();
+
+    dsp_state_t *dsp = &ctx->dsp;
+    float *in_buf = ctx->in;
+    dsp_state_init(dsp, (float)w.rate);
+    dsp->fixed = ro->fixed;
+
+    // the resampler only decimates: a lower rate would come out at the
+    // file's rate under a header claiming the target's, i.e. off pitch
+    if (dsp->in_rate < cfg->target_rate) {
+        fprintf(stderr, "%s: %d Hz is below the %.2f Hz target, upsampling "
+                "is not supported\n", in, w.rate, cfg->target_rate);
+        fclose(w.f);
+        return -1;
+    }
+
+    // output is at most one byte per input frame, plus the flush tail
+    size_t cap = (size_t)w.frames_left + RENDER_BLOCK;
+    uint8_t *data = cap > w.frames_left ? malloc(cap) : NULL;
+    if (!data) {
+        perror(in);
+        fclose(w.f);
+        return -1;
+    }
+
+    uint32_t len = 0;
+    uint32_t frames = 0;
+    int n;
+
+    while ((n = wav_read(&w, ctx->raw, in_buf, RENDER_BLOCK, cfg->gain)) > 0) {
+        len += dsp_process_block(dsp, cfg, in_buf, data + len, n, NULL);
+        frames += n;
+    }
+    fclose(w.f);
+
+    // flush the filter delay so the tail isn't cut off (in source samples)
+    int tail = (dsp->fir.taps + RS_TAPS + HB_TAPS_1) * dsp->dec.factor;
+    for (int i = 0; i < tail; i++) in_buf[i] = 0.0f;
+    len += dsp_process_block(dsp, cfg, in_buf, data + len, tail, NULL);
+
+    int rc = write_output(out, fmt, data, len, cfg->target_rate);
+    free(data);
+
+    if (rc == 0) {
+        double secs = (now_ns() - t0) / 1e9;
+        double audio = frames / (double)w.rate;
+        printf("%s → %s: %u samples, %.1fx realtime\n",
+               in, out, len, secs > 0 ? audio / secs : 0.0);
+    }
+    return rc;
+}
+
+// --------------------------------------------------------------------
+// Directory mode
+// --------------------------------------------------------------------
+typedef struct {
+    char **in;
+    char **out;
+    int count;
+    atomic_int next;
+    atomic_int failed;
+    const render_opts_t *ro;
+} render_job_t;
+
+static void *render_worker(void *arg)
+{
+    render_job_t *job = arg;
+
+    render_ctx_t *ctx = malloc(sizeof(*ctx));
+    if (!ctx) {
+        perror("render worker");   // the remaining workers take over
+        return NULL;
+    }
+
+    for (;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->count) break;
+        if (render_file(ctx, job->in[i], job->out[i], job->ro) < 0)
+            atomic_fetch_add(&job->failed, 1);
+    }
+
+    free(ctx);
+    return NULL;
+}
+
+static bool has_wav_ext(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && !strcasecmp(ext, ".wav");
+}
+
+static void render_job_free(render_job_t *job)
+{
+    for (int i = 0; i < job->count; i++) {
+        free(job->in[i]);
+        free(job->out[i]);
+    }
+    free(job->in);
+    free(job->out);
+}
+
+static int render_dir(const char *in, const char *out, const render_opts_t *ro)
+{
+    const char *ext = ro->format ? ro->format : "8svx";
+    if (strcmp(ext, "raw") && strcmp(ext, "8svx") && strcmp(ext, "wav")) {
+        fprintf(stderr, "render: unknown format '%s'\n", ext);
+        return 1;
+    }
+
+    if (mkdir(out, 0777) < 0) {
+        struct stat st;
+        if (stat(out, &st) < 0 || !S_ISDIR(st.st_mode)) {
+            perror(out);
+            return 1;
+        }
+    }
+
+    DIR *d = opendir(in);
+    if (!d) {
+        perror(in);
+        return 1;
+    }
+
+    render_job_t job = { .ro = ro };
+    int cap = 0;
+    bool oom = false;
+    struct dirent *de;
+
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.' || !has_wav_ext(de->d_name))
+            continue;
+        if (job.count == cap) {
+            int grown = cap ? cap * 2 : 64;
+            char **ins = realloc(job.in, grown * sizeof(char *));
+            if (ins) job.in = ins;
+            char **outs = ins ? realloc(job.out, grown * sizeof(char *)) : NULL;
+            if (outs) job.out = outs;
+            if (!ins || !outs) {
+                oom = true;
+                break;
+            }
+            cap = grown;
+        }
+        int stem = (int)(strrchr(de->d_name, '.') - de->d_name);
+        char *src, *dst;
+        if (asprintf(&src, "%s/%s", in, de->d_name) < 0) {
+            oom = true;
+            break;
+        }
+        if (asprintf(&dst, "%s/%.*s.%s", out, stem, de->d_name, ext) < 0) {
+            free(src);
+            oom = true;
+            break;
+        }
+        job.in[job.count] = src;
+        job.out[job.count] = dst;
+        job.count++;
+    }
+    closedir(d);
+
+    if (oom || job.count == 0) {
+        if (oom)
+            perror(in);
+        else
+            fprintf(stderr, "%s: no .wav files\n", in);
+        render_job_free(&job);
+        return 1;
+    }
+
+    int jobs = ro->jobs > 0 ? ro->jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    if (jobs > job.count) jobs = job.count;
+
+    pthread_t th[jobs];
+    for (int i = 0; i < jobs; i++)
+        pthread_create(&th[i], NULL, render_worker, &job);
+    for (int i = 0; i < jobs; i++)
+        pthread_join(th[i], NULL);
+
+    int failed = atomic_load(&job.failed);
+    printf("%d/%d files rendered with %d workers\n",
+           job.count - failed, job.count, jobs);
+
+    render_job_free(&job);
+
+    return failed ? 1 : 0;
+}
+
+// --------------------------------------------------------------------
+int render_run(const char *in, const char *out, const render_opts_t *ro)
+{
+    struct stat st;
+    if (stat(in, &st) < 0) {
+        perror(in);
+        return 1;
+    }
+
+    if (S_ISDIR(st.st_mode))
+        return render_dir(in, out, ro);
+
+    render_ctx_t *ctx = malloc(sizeof(*ctx));
+    if (!ctx) return 1;
+    int rc = render_file(ctx, in, out, ro);
+    free(ctx);
+    return rc < 0 ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "dsp.h"
+
+// Offline render: WAV in → Amiga-ready 8-bit out, no ALSA, no SPI,
+// no pacing. Output format follows the output extension:
+//   .raw   signed 8-bit (Amiga native)
+//   .8svx  IFF 8SVX with VHDR at the target rate
+//   .wav   8-bit unsigned PCM WAV at the target rate
+typedef struct {
+    dsp_config_t cfg;       // preset + gain + target_rate
+    const char *format;     // directory mode: "raw", "8svx" or "wav"
+    int jobs;               // directory mode workers, 0 = all cores
+    bool fixed;             // integer DSP path (dsp_fixed.c)
+} render_opts_t;
+
+// in/out are files, or both directories (every *.wav in `in` is
+// converted in parallel, one DSP state per worker).
+// Returns 0 on success, 1 if any file failed.
+int render_run(const char *in, const char *out, const render_opts_t *ro);
+
+#endif
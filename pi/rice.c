@@ -0,0 +1,177 @@
+#include "rice.h"
+
+#include <string.h>
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u) {
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+// --------------------------------------------------------------------
+// Bit I/O, MSB first
+// --------------------------------------------------------------------
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    int nbits;
+} bitw_t;
+
+static inline void put_bits(bitw_t *w, uint32_t v, int n)  // n <= 32
+{
+    w->acc = (w->acc << n) | (v & (n == 32 ? 0xFFFFFFFFu : ((1u << n) - 1)));
+    w->nbits += n;
+    while (w->nbits >= 8) {
+        w->nbits -= 8;
+        *w->p++ = (uint8_t)(w->acc >> w->nbits);
+    }
+}
+
+static inline void put_ones(bitw_t *w, int n)
+{
+    while (n >= 16) { put_bits(w, 0xFFFF, 16); n -= 16; }
+    if (n) put_bits(w, (1u << n) - 1, n);
+}
+
+typedef struct {
+    const uint8_t *p, *end;
+    uint64_t acc;
+    int nbits;
+    int overrun;
+} bitr_t;
+
+static inline void refill(bitr_t *r)
+{
+    while (r->nbits <= 56) {
+        uint8_t b = 0;
+        if (r->p < r->end) b = *r->p++;
+        else r->overrun++;
+        r->acc |= (uint64_t)b << (56 - r->nbits);
+        r->nbits += 8;
+    }
+}
+
+static inline uint32_t get_bits(bitr_t *r, int n)   // n <= 32
+{
+    if (n == 0) return 0;
+    if (r->nbits < n) refill(r);
+    uint32_t v = (uint32_t)(r->acc >> (64 - n));
+    r->acc <<= n;
+    r->nbits -= n;
+    return v;
+}
+
+// --------------------------------------------------------------------
+// k: start from the mean (cost is minimised near 2^k ≈ mean for
+// geometric deltas), then take the exact cheapest k at or below it;
+// sparse jumps (square waves, clicks) want a much smaller k.
+// --------------------------------------------------------------------
+static uint64_t block_cost(const uint32_t *u, int n, int k)
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < n; i++) {
+        uint32_t q = u[i] >> k;
+        bits += q >= RICE_ESC ? RICE_ESC + 32 : q + 1 + k;
+    }
+    return bits;
+}
+
+static int pick_k(const uint32_t *u, int n)
+{
+    if (n <= 0) return 0;
+
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += u[i];
+    uint64_t mean = sum / n;
+
+    int kmax = 0;
+    while (kmax < 30 && (2ULL << kmax) <= mean)
+        kmax++;
+
+    int best = kmax;
+    uint64_t best_cost = block_cost(u, n, kmax);
+    for (int k = kmax - 1; k >= 0; k--) {
+        uint64_t c = block_cost(u, n, k);
+        if (c >= best_cost) break;      // near enough convex in k
+        best = k;
+        best_cost = c;
+    }
+    return best;
+}
+
+static inline void put_le16(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; }
+static inline void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+static inline uint32_t get_le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+static inline uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// --------------------------------------------------------------------
+size_t rice_encode_block(const int32_t *x, int n, uint8_t *dst)
+{
+    if (n <= 0) return 0;
+    if (n > RICE_BLOCK) n = RICE_BLOCK;
+
+    uint32_t u[RICE_BLOCK];
+    for (int i = 1; i < n; i++)
+        u[i - 1] = zigzag(x[i] - x[i - 1]);
+    int k = pick_k(u, n - 1);
+
+    bitw_t w = { .p = dst + RICE_HDR };
+    for (int i = 0; i < n - 1; i++) {
+        uint32_t q = u[i] >> k;
+        if (q >= RICE_ESC) {
+            put_ones(&w, RICE_ESC);
+            put_bits(&w, u[i], 32);
+        } else {
+            put_ones(&w, (int)q);
+            put_bits(&w, 0, 1);
+            if (k) put_bits(&w, u[i], k);
+        }
+    }
+    if (w.nbits)
+        put_bits(&w, 0, 8 - w.nbits);   // pad to a byte
+
+    uint32_t nbytes = (uint32_t)(w.p - (dst + RICE_HDR));
+    put_le16(dst, n);
+    dst[2] = (uint8_t)k;
+    dst[3] = 0;
+    put_le32(dst + 4, (uint32_t)x[0]);
+    put_le32(dst + 8, nbytes);
+    return RICE_HDR + nbytes;
+}
+
+size_t rice_decode_block(const uint8_t *src, size_t len, int32_t *x, int *n)
+{
+    if (len < RICE_HDR) return 0;
+
+    int cnt = (int)get_le16(src);
+    int k = src[2];
+    uint32_t nbytes = get_le32(src + 8);
+    if (cnt < 1 || cnt > RICE_BLOCK || k > 30 || RICE_HDR + (size_t)nbytes > len)
+        return 0;
+
+    bitr_t r = { .p = src + RICE_HDR, .end = src + RICE_HDR + nbytes };
+    x[0] = (int32_t)get_le32(src + 4);
+
+    for (int i = 1; i < cnt; i++) {
+        uint32_t q = 0;
+        while (q < RICE_ESC && get_bits(&r, 1))
+            q++;
+
+        uint32_t u = q == RICE_ESC ? get_bits(&r, 32)
+                                   : (q << k) | get_bits(&r, k);
+        x[i] = (int32_t)((uint32_t)x[i - 1] + (uint32_t)unzigzag(u));
+    }
+    if (r.overrun > 8)          // refill reads ahead up to 8 bytes
+        return 0;
+
+    *n = cnt;
+    return RICE_HDR + nbytes;
+}
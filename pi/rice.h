@@ -0,0 +1,34 @@
+#ifndef RICE_H
+#define RICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Lossless sample coding for the session recorder: per block, the first
+// sample raw, then Rice-coded zigzag deltas with the block's best k.
+// Quiet passages and the 8-bit Amiga stream come out at 2-5 bits/sample.
+//
+// Block layout (little-endian):
+//   u16 n        samples in the block (1..RICE_BLOCK)
+//   u8  k        Rice parameter
+//   u8  reserved
+//   i32 first    first sample
+//   u32 nbytes   payload bytes that follow
+//   payload      n-1 codes: q ones, a zero, k low bits; q >= RICE_ESC is
+//                RICE_ESC ones then the zigzag value in 32 bits
+
+#define RICE_BLOCK   4096
+#define RICE_ESC     24
+#define RICE_HDR     12
+// worst case: every delta escaped
+#define RICE_MAX_BYTES(n) (RICE_HDR + ((size_t)(n) * (RICE_ESC + 32) + 7) / 8)
+
+// Encode n samples (n <= RICE_BLOCK) into dst; returns bytes written.
+size_t rice_encode_block(const int32_t *x, int n, uint8_t *dst);
+
+// Decode one block from src (len bytes available). Writes up to
+// RICE_BLOCK samples to x and their count to *n. Returns bytes consumed,
+// 0 on a truncated or corrupt block.
+size_t rice_decode_block(const uint8_t *src, size_t len, int32_t *x, int *n);
+
+#endif
@@ -0,0 +1,86 @@
+// Round-trip test for the recorder's Rice coding: 8-bit streams (silence,
+// a quantised sine, noise, full-scale square) and 24-bit input (sine with
+// noise, extremes that force escapes), in full and short blocks. Every
+// sample must come back exactly; a truncated block must be rejected.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rice.h"
+
+static uint8_t enc[RICE_MAX_BYTES(RICE_BLOCK)];
+static int32_t in[RICE_BLOCK], out[RICE_BLOCK];
+
+static uint32_t xorshift(uint32_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static int check(const char *name, int n, double *bits)
+{
+    size_t len = rice_encode_block(in, n, enc);
+    if (len > RICE_MAX_BYTES(n)) {
+        printf("rice_test %s: FAIL (%zu bytes > bound)\n", name, len);
+        return 1;
+    }
+
+    int m = 0;
+    size_t used = rice_decode_block(enc, len, out, &m);
+    if (used != len || m != n || memcmp(in, out, n * sizeof(int32_t))) {
+        printf("rice_test %s: FAIL (round trip, n=%d)\n", name, n);
+        return 1;
+    }
+    if (len > RICE_HDR + 1 && rice_decode_block(enc, len - 1, out, &m) != 0) {
+        printf("rice_test %s: FAIL (truncated block accepted)\n", name);
+        return 1;
+    }
+
+    *bits = 8.0 * len / n;
+    return 0;
+}
+
+static int run(const char *name, int kind)
+{
+    uint32_t seed = 0x2545F491;
+    static const int sizes[] = { RICE_BLOCK, 1, 2, 37, 1000 };
+    double bits = 0.0;
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        for (int i = 0; i < n; i++) {
+            double t = i / 28149.96;
+            switch (kind) {
+            case 0: in[i] = 128; break;
+            case 1: in[i] = 128 + (int)lrint(100.0 * sin(2 * M_PI * 440.0 * t)); break;
+            case 2: in[i] = xorshift(&seed) & 0xFF; break;
+            case 3: in[i] = (i / 16) & 1 ? 255 : 0; break;
+            case 4: in[i] = (int)lrint(4e6 * sin(2 * M_PI * 1000.0 * t)) +
+                            (int)(xorshift(&seed) & 0xFF) - 128; break;
+            default: in[i] = (i & 1) ? 8388607 : -8388608; break;
+            }
+        }
+        double b;
+        if (check(name, n, &b))
+            return 1;
+        if (s == 0)
+            bits = b;
+    }
+
+    printf("rice_test %s: OK (%.2f bits/sample)\n", name, bits);
+    return 0;
+}
+
+int main(void)
+{
+    static const char *names[] = {
+        "silence", "sine8", "noise8", "square8", "sine24", "extremes24",
+    };
+    for (int k = 0; k < 6; k++)
+        if (run(names[k], k))
+            return 1;
+    return 0;
+}
@@ -1,17 +1,39 @@
 #include "ringbuf.h"
 #include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 int ringbuf_init(ringbuf_t *r, uint32_t size)
 {
     // size must be power of 2
     if ((size & (size - 1)) != 0) return -1;
 
-    r->buf = malloc(size);
-    if (!r->buf) return -1;
+    uint8_t *buf = malloc(size);
+    if (!buf) return -1;
 
+    return ringbuf_init_buf(r, buf, size);
+}
+
+int ringbuf_init_buf(ringbuf_t *r, uint8_t *buf, uint32_t size)
+{
+    if (!buf || (size & (size - 1)) != 0) return -1;
+
+    // fault the whole buffer in now, not in the audio thread
+    memset(buf, 0, size);
+
+    r->buf = buf;
     r->size = size;
     atomic_store(&r->write_idx, 0);
     atomic_store(&r->read_idx, 0);
+    r->read_cache = 0;
+    r->write_cache = 0;
+
+    atomic_store(&r->wake_seq, 0);
+    atomic_store(&r->waiting, 0);
+    atomic_store(&r->wait_min, 1);
 
     return 0;
 }
@@ -20,3 +42,51 @@ void ringbuf_free(ringbuf_t *r)
 {
     free(r->buf);
 }
+
+static long futex(atomic_uint *uaddr, int op, uint32_t val,
+                  const struct timespec *timeout)
+{
+    return syscall(SYS_futex, (uint32_t *)uaddr, op, val, timeout, NULL, 0);
+}
+
+int ringbuf_wait(ringbuf_t *r, uint32_t min_fill, int timeout_ms)
+{
+    if (ringbuf_fill(r) >= min_fill)
+        return RINGBUF_READY;
+
+    atomic_store_explicit(&r->wait_min, min_fill, memory_order_relaxed);
+    uint32_t seq = atomic_load_explicit(&r->wake_seq, memory_order_relaxed);
+    atomic_store_explicit(&r->waiting, 1, memory_order_relaxed);
+
+    // pairs with the fence in ringbuf_notify: either we see the new
+    // fill here, or the producer sees waiting == 1 and wakes us
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (ringbuf_fill(r) >= min_fill) {
+        atomic_store_explicit(&r->waiting, 0, memory_order_relaxed);
+        return RINGBUF_READY;
+    }
+
+    struct timespec ts = {
+        .tv_sec  = timeout_ms / 1000,
+        .tv_nsec = (long)(timeout_ms % 1000) * 1000000L,
+    };
+    long rc = futex(&r->wake_seq, FUTEX_WAIT_PRIVATE, seq, &ts);
+    int err = errno;
+
+    atomic_store_explicit(&r->waiting, 0, memory_order_relaxed);
+
+    if (rc < 0 && err == ETIMEDOUT)
+        return RINGBUF_TIMEOUT;
+    return RINGBUF_WOKEN;
+}
+
+int ringbuf_wake(ringbuf_t *r)
+{
+    // only one wake per sleep, however many blocks get pushed meanwhile
+    if (!atomic_exchange_explicit(&r->waiting, 0, memory_order_relaxed))
+        return 0;
+    atomic_fetch_add_explicit(&r->wake_seq, 1, memory_order_release);
+    futex(&r->wake_seq, FUTEX_WAKE_PRIVATE, 1, NULL);
+    return 1;
+}
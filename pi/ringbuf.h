@@ -2,16 +2,37 @@
 #define RINGBUF_H
 
 #include <stdint.h>
+#include <string.h>
+#include <stdalign.h>
 #include <stdatomic.h>
 
+#define RINGBUF_CACHELINE 64
+
+// Producer and consumer indices live on separate cache lines, and each
+// side keeps a private cached copy of the other side's index so the
+// shared line is only touched when the cached view runs out.
 typedef struct {
-    uint8_t *buf;
+    // producer
+    alignas(RINGBUF_CACHELINE) atomic_uint write_idx;
+    uint32_t read_cache;        // producer's last seen read_idx
+
+    // consumer
+    alignas(RINGBUF_CACHELINE) atomic_uint read_idx;
+    uint32_t write_cache;       // consumer's last seen write_idx
+
+    // consumer wakeup (futex), see ringbuf_wait / ringbuf_notify
+    alignas(RINGBUF_CACHELINE) atomic_uint wake_seq;  // futex word
+    atomic_uint waiting;        // consumer is asleep on wake_seq
+    atomic_uint wait_min;       // fill the consumer is waiting for
+
+    // read-only after init
+    alignas(RINGBUF_CACHELINE) uint8_t *buf;
     uint32_t size;     // must be power of 2
-    atomic_uint write_idx;
-    atomic_uint read_idx;
 } ringbuf_t;
 
 int ringbuf_init(ringbuf_t *r, uint32_t size);
+// Caller-provided storage (e.g. static, locked at startup); don't ringbuf_free
+int ringbuf_init_buf(ringbuf_t *r, uint8_t *buf, uint32_t size);
 void ringbuf_free(ringbuf_t *r);
 
 static inline uint32_t ringbuf_mask(const ringbuf_t *r) {
@@ -22,27 +43,121 @@ static inline uint32_t ringbuf_mask(const ringbuf_t *r) {
 static inline int ringbuf_push(ringbuf_t *r, uint8_t v)
 {
     uint32_t w = atomic_load_explicit(&r->write_idx, memory_order_relaxed);
-    uint32_t r_i = atomic_load_explicit(&r->read_idx, memory_order_acquire);
+    uint32_t next = (w + 1) & ringbuf_mask(r);
 
-    if (((w + 1) & ringbuf_mask(r)) == r_i)
-        return 0; // full
+    if (next == r->read_cache) {
+        r->read_cache = atomic_load_explicit(&r->read_idx, memory_order_acquire);
+        if (next == r->read_cache)
+            return 0; // full
+    }
 
     r->buf[w] = v;
-    atomic_store_explicit(&r->write_idx, (w + 1) & ringbuf_mask(r), memory_order_release);
+    atomic_store_explicit(&r->write_idx, next, memory_order_release);
     return 1;
 }
 
 static inline int ringbuf_pop(ringbuf_t *r, uint8_t *v)
 {
     uint32_t r_i = atomic_load_explicit(&r->read_idx, memory_order_relaxed);
-    uint32_t w_i = atomic_load_explicit(&r->write_idx, memory_order_acquire);
 
-    if (r_i == w_i)
-        return 0; // empty
+    if (r_i == r->write_cache) {
+        r->write_cache = atomic_load_explicit(&r->write_idx, memory_order_acquire);
+        if (r_i == r->write_cache)
+            return 0; // empty
+    }
 
     *v = r->buf[r_i];
     atomic_store_explicit(&r->read_idx, (r_i + 1) & ringbuf_mask(r), memory_order_release);
     return 1;
 }
 
+// Pushes up to n bytes (memcpy across the wrap), returns bytes pushed.
+static inline uint32_t ringbuf_push_bulk(ringbuf_t *r, const uint8_t *src, uint32_t n)
+{
+    uint32_t mask = ringbuf_mask(r);
+    uint32_t w = atomic_load_explicit(&r->write_idx, memory_order_relaxed);
+    uint32_t space = (r->read_cache - w - 1) & mask;
+
+    if (space < n) {
+        r->read_cache = atomic_load_explicit(&r->read_idx, memory_order_acquire);
+        space = (r->read_cache - w - 1) & mask;
+    }
+    if (n > space) n = space;
+    if (n == 0) return 0;
+
+    uint32_t first = r->size - w;
+    if (first > n) first = n;
+    memcpy(r->buf + w, src, first);
+    memcpy(r->buf, src + first, n - first);
+
+    atomic_store_explicit(&r->write_idx, (w + n) & mask, memory_order_release);
+    return n;
+}
+
+// Pops up to n bytes (memcpy across the wrap), returns bytes popped.
+static inline uint32_t ringbuf_pop_bulk(ringbuf_t *r, uint8_t *dst, uint32_t n)
+{
+    uint32_t mask = ringbuf_mask(r);
+    uint32_t r_i = atomic_load_explicit(&r->read_idx, memory_order_relaxed);
+    uint32_t avail = (r->write_cache - r_i) & mask;
+
+    if (avail < n) {
+        r->write_cache = atomic_load_explicit(&r->write_idx, memory_order_acquire);
+        avail = (r->write_cache - r_i) & mask;
+    }
+    if (n > avail) n = avail;
+    if (n == 0) return 0;
+
+    uint32_t first = r->size - r_i;
+    if (first > n) first = n;
+    memcpy(dst, r->buf + r_i, first);
+    memcpy(dst + first, r->buf, n - first);
+
+    atomic_store_explicit(&r->read_idx, (r_i + n) & mask, memory_order_release);
+    return n;
+}
+
+// Producer: free space, refreshing the cached read index
+static inline uint32_t ringbuf_space(ringbuf_t *r)
+{
+    uint32_t w = atomic_load_explicit(&r->write_idx, memory_order_relaxed);
+    r->read_cache = atomic_load_explicit(&r->read_idx, memory_order_acquire);
+    return (r->read_cache - w - 1) & ringbuf_mask(r);
+}
+
+// Current fill, safe from any thread (approximate while both sides run)
+static inline uint32_t ringbuf_fill(ringbuf_t *r)
+{
+    uint32_t w = atomic_load_explicit(&r->write_idx, memory_order_acquire);
+    uint32_t r_i = atomic_load_explicit(&r->read_idx, memory_order_acquire);
+    return (w - r_i) & ringbuf_mask(r);
+}
+
+// --------------------------------------------------------------------
+// Blocking consumer
+// --------------------------------------------------------------------
+enum {
+    RINGBUF_READY,      // fill already at min_fill, did not sleep
+    RINGBUF_WOKEN,      // slept, woken by the producer
+    RINGBUF_TIMEOUT,    // slept until the timeout
+};
+
+// Consumer: sleep until fill >= min_fill or timeout_ms passes.
+int ringbuf_wait(ringbuf_t *r, uint32_t min_fill, int timeout_ms);
+
+int ringbuf_wake(ringbuf_t *r);
+
+// Producer: call after pushing. Costs a fence and a load unless the
+// consumer is asleep and its watermark has been crossed; only then is a
+// futex wake issued. Returns 1 if it woke the consumer.
+static inline int ringbuf_notify(ringbuf_t *r)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&r->waiting, memory_order_relaxed))
+        return 0;
+    if (ringbuf_fill(r) < atomic_load_explicit(&r->wait_min, memory_order_relaxed))
+        return 0;
+    return ringbuf_wake(r);
+}
+
 #endif
@@ -0,0 +1,181 @@
+#define _GNU_SOURCE
+#include "rt.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+// What we asked for and what we got, for rt_status()
+static atomic_int fifo_ok, fifo_denied, pin_failed;
+static int mlock_errno = -1;        // -1 = not attempted, 0 = locked
+static char denied_names[64];       // written before each thread starts
+
+void rt_config_defaults(rt_config_t *rc)
+{
+    rc->thread[RT_AUDIO] = (rt_thread_cfg_t){ .priority = 80, .cpu = 3 };
+    rc->thread[RT_SPI]   = (rt_thread_cfg_t){ .priority = 70, .cpu = 2 };
+    rc->thread[RT_UI]    = (rt_thread_cfg_t){ .priority = 0,  .cpu = 0 };
+    rc->thread[RT_GPIO]  = (rt_thread_cfg_t){ .priority = 0,  .cpu = 0 };
+    rc->thread[RT_EXPORT] = (rt_thread_cfg_t){ .priority = 0, .cpu = 0 };
+    rc->thread[RT_RECORD] = (rt_thread_cfg_t){ .priority = 0, .cpu = 0 };
+    rc->lock_memory = true;
+}
+
+void rt_config_off(rt_config_t *rc)
+{
+    for (int i = 0; i < RT_THREADS; i++)
+        rc->thread[i] = (rt_thread_cfg_t){ .priority = 0, .cpu = -1 };
+    rc->lock_memory = false;
+}
+
+int rt_parse_thread(const char *spec, rt_thread_cfg_t *tc)
+{
+    char *end;
+    long prio = strtol(spec, &end, 10);
+    if (end == spec || prio < 0 || prio > 99) return -1;
+
+    long cpu = -1;
+    if (*end == ':') {
+        const char *c = end + 1;
+        cpu = strtol(c, &end, 10);
+        if (end == c || cpu < -1) return -1;
+    }
+    if (*end) return -1;
+
+    tc->priority = (int)prio;
+    tc->cpu = (int)cpu;
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// Memory
+// --------------------------------------------------------------------
+void rt_lock_memory(const rt_config_t *rc)
+{
+    if (!rc->lock_memory) return;
+
+    // keep freed memory in the heap and never mmap a malloc: once a page
+    // is faulted in and locked it stays
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    mlock_errno = mlockall(MCL_CURRENT | MCL_FUTURE) < 0 ? errno : 0;
+}
+
+// --------------------------------------------------------------------
+// Threads
+// --------------------------------------------------------------------
+typedef struct {
+    void *(*fn)(void *);
+    void *arg;
+    char name[16];
+} rt_start_t;
+
+static rt_start_t starts[RT_MAX_THREADS];
+static atomic_int nstarts;
+
+static __attribute__((noinline)) void prefault_stack(void)
+{
+    volatile uint8_t buf[RT_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(buf); i += 4096)
+        buf[i] = 0;
+}
+
+static void *rt_trampoline(void *arg)
+{
+    rt_start_t *s = arg;
+    pthread_setname_np(pthread_self(), s->name);
+    prefault_stack();
+    return s->fn(s->arg);
+}
+
+static void note_denied(const char *name)
+{
+    size_t len = strlen(denied_names);
+    snprintf(denied_names + len, sizeof(denied_names) - len, "%s%s",
+             len ? "," : "", name);
+    atomic_fetch_add(&fifo_denied, 1);
+}
+
+int rt_thread_create(pthread_t *th, const rt_thread_cfg_t *tc, const char *name,
+                     void *(*fn)(void *), void *arg)
+{
+    int slot = atomic_fetch_add(&nstarts, 1);
+    if (slot >= (int)(sizeof(starts) / sizeof(starts[0])))
+        return pthread_create(th, NULL, fn, arg);
+
+    rt_start_t *s = &starts[slot];
+    s->fn = fn;
+    s->arg = arg;
+    snprintf(s->name, sizeof(s->name), "%s", name);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    // explicit size: the 8 MB default would all be locked by MCL_FUTURE
+    pthread_attr_setstacksize(&attr, RT_STACK_SIZE);
+
+    if (tc && tc->cpu >= 0) {
+        if (tc->cpu < sysconf(_SC_NPROCESSORS_ONLN)) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(tc->cpu, &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        } else {
+            atomic_fetch_add(&pin_failed, 1);
+        }
+    }
+
+    if (tc && tc->priority > 0) {
+        struct sched_param sp = { .sched_priority = tc->priority };
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &sp);
+    }
+
+    int err = pthread_create(th, &attr, rt_trampoline, s);
+    if (err == EPERM && tc && tc->priority > 0) {
+        // no CAP_SYS_NICE / rtprio limit: run it anyway, just not RT
+        note_denied(name);
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        err = pthread_create(th, &attr, rt_trampoline, s);
+    } else if (!err && tc && tc->priority > 0) {
+        atomic_fetch_add(&fifo_ok, 1);
+    }
+
+    pthread_attr_destroy(&attr);
+    return err;
+}
+
+// --------------------------------------------------------------------
+const char *rt_status(void)
+{
+    static char buf[160];
+    int len = 0;
+
+    if (atomic_load(&fifo_denied))
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "no SCHED_FIFO for %s (needs CAP_SYS_NICE or rtprio)",
+                        denied_names);
+    else if (atomic_load(&fifo_ok))
+        len += snprintf(buf + len, sizeof(buf) - len, "SCHED_FIFO ok");
+    else
+        len += snprintf(buf + len, sizeof(buf) - len, "SCHED_OTHER");
+
+    if (mlock_errno == 0)
+        len += snprintf(buf + len, sizeof(buf) - len, ", memory locked");
+    else if (mlock_errno > 0)
+        len += snprintf(buf + len, sizeof(buf) - len, ", mlockall: %s",
+                        strerror(mlock_errno));
+
+    if (atomic_load(&pin_failed))
+        snprintf(buf + len, sizeof(buf) - len, ", some cores missing");
+
+    return buf;
+}
@@ -0,0 +1,50 @@
+#ifndef RT_H
+#define RT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// Real-time runtime: per-thread scheduling and core pinning, locked and
+// prefaulted memory. Everything degrades to normal scheduling when the
+// privileges are missing; rt_status() says what could not be obtained.
+
+typedef struct {
+    int priority;           // SCHED_FIFO 1..99, 0 = SCHED_OTHER
+    int cpu;                // pin to this core, -1 = any
+} rt_thread_cfg_t;
+
+typedef enum { RT_AUDIO, RT_SPI, RT_UI, RT_GPIO, RT_EXPORT, RT_RECORD, RT_THREADS } rt_thread_id_t;
+
+typedef struct {
+    rt_thread_cfg_t thread[RT_THREADS];
+    bool lock_memory;       // mlockall + no heap trimming
+} rt_config_t;
+
+#define RT_MAX_THREADS    32     // audio, SPI, GPIO and Pico link per instance, plus the rest
+#define RT_STACK_SIZE     (256 * 1024)
+#define RT_STACK_PREFAULT (128 * 1024)   // touched before the thread body runs
+
+// Pi 4 defaults: audio and SPI get a core each, UI and GPIO share core 0
+// with the rest of the system.
+void rt_config_defaults(rt_config_t *rc);
+
+// No RT at all (--no-rt)
+void rt_config_off(rt_config_t *rc);
+
+// "PRIO" or "PRIO:CPU", e.g. "80:3". Returns 0 or -1 on a bad spec.
+int rt_parse_thread(const char *spec, rt_thread_cfg_t *tc);
+
+// Process-wide: mlockall, disable heap trimming and mmap'd mallocs so
+// later allocations don't fault. Call once before creating threads.
+void rt_lock_memory(const rt_config_t *rc);
+
+// pthread_create with the thread's policy, priority, affinity and a
+// prefaulted stack. Falls back to default scheduling if SCHED_FIFO is
+// refused, so the thread always starts.
+int rt_thread_create(pthread_t *th, const rt_thread_cfg_t *tc, const char *name,
+                     void *(*fn)(void *), void *arg);
+
+// Human-readable summary, e.g. "SCHED_FIFO ok, memory locked"
+const char *rt_status(void);
+
+#endif
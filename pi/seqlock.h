@@ -0,0 +1,56 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Single-writer sequence lock. The sequence is odd while a write is in
+// progress; a reader copies the data and keeps it only if the sequence
+// was even and unchanged across the copy. Readers never block the
+// writer and, with seqlock_try_read_*, never wait on it either.
+typedef struct {
+    atomic_uint seq;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *s)
+{
+    atomic_store_explicit(&s->seq, 0, memory_order_relaxed);
+}
+
+static inline void seqlock_write_begin(seqlock_t *s)
+{
+    unsigned v = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, v + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_end(seqlock_t *s)
+{
+    unsigned v = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, v + 1, memory_order_release);
+}
+
+// Returns the sequence to validate against, or false if a write is in
+// progress right now.
+static inline bool seqlock_try_read_begin(const seqlock_t *s, unsigned *seq)
+{
+    *seq = atomic_load_explicit((atomic_uint *)&s->seq, memory_order_acquire);
+    return (*seq & 1) == 0;
+}
+
+// True if the data copied since seqlock_try_read_begin is consistent.
+static inline bool seqlock_try_read_end(const seqlock_t *s, unsigned seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((atomic_uint *)&s->seq,
+                                memory_order_relaxed) == seq;
+}
+
+// Number of completed writes
+static inline unsigned seqlock_generation(unsigned seq)
+{
+    return seq >> 1;
+}
+
+#endif
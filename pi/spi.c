@@ -1,32 +1,94 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/timerfd.h>
 #include <linux/spi/spidev.h>
 #include <time.h>
 
 #include "spi.h"
 #include "ringbuf.h"
 
-#define SPI_DEV "/dev/spidev0.0"
 #define SPI_SPEED 500000
 
-// Convert ns
-static inline void ts_from_ns(struct timespec *ts, uint64_t ns)
+#define SPI_BATCH_MAX   8       // transfers per SPI_IOC_MESSAGE
+#define SPI_BURST_MIN   16
+#define SPI_BURST_MAX   256
+#define SPI_IDLE_TICKS  50      // empty ticks before going back to idle
+#define SPI_IDLE_WAIT_MS 1000   // wait on an empty ring (producer wakes us)
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+// Adaptive burst size: small bursts while the Pi ring is shallow (low
+// latency, evenly spread), larger ones as it deepens (less overhead).
+// --------------------------------------------------------------------
+static int pick_burst(uint32_t fill)
 {
-    ts->tv_sec  = ns / 1000000000ULL;
-    ts->tv_nsec = ns % 1000000000ULL;
+    int b = SPI_BURST_MIN;
+    while (b < SPI_BURST_MAX && fill >= (uint32_t)b * 16)
+        b *= 2;
+    return b;
+}
+
+// --------------------------------------------------------------------
+// One batched transfer: up to SPI_BATCH_MAX bursts in one ioctl, spaced
+// by delay_usecs so the Pico sees a steady trickle instead of a clump.
+// Falls back to plain write() when fd is not a spidev (ENOTTY), e.g. the
+// fifo pico_sim reads from.
+// --------------------------------------------------------------------
+static _Thread_local bool use_write;    // per sender: one per instance
+
+static int spi_send_batch(int fd, const uint8_t *buf, const int *lens,
+                          int n, uint16_t delay_us)
+{
+    if (use_write) {
+        for (int i = 0; i < n; i++) {
+            if (write(fd, buf, lens[i]) < 0) return -1;
+            buf += lens[i];
+        }
+        return n;
+    }
+
+    struct spi_ioc_transfer xfer[SPI_BATCH_MAX];
+    memset(xfer, 0, sizeof(xfer));
+
+    const uint8_t *p = buf;
+    for (int i = 0; i < n; i++) {
+        xfer[i].tx_buf = (uintptr_t)p;
+        xfer[i].len = lens[i];
+        xfer[i].speed_hz = SPI_SPEED;
+        xfer[i].bits_per_word = 8;
+        xfer[i].delay_usecs = (i < n - 1) ? delay_us : 0;
+        p += lens[i];
+    }
+
+    if (ioctl(fd, SPI_IOC_MESSAGE(n), xfer) < 0) {
+        if (errno != ENOTTY) return -1;
+        use_write = true;
+        return spi_send_batch(fd, buf, lens, n, delay_us);
+    }
+    return 1;
 }
 
 static void *spi_thread(void *arg)
 {
     spi_args_t *sa = arg;
     ringbuf_t *rb = sa->rb;
+    spi_stats_t *st = sa->stats;
 
-    int fd = open(SPI_DEV, O_RDWR);
+    const char *dev = sa->dev ? sa->dev : SPI_DEV_DEFAULT;
+    int fd = open(dev, O_RDWR);
     if (fd < 0) {
-        perror("open SPI");
+        perror(dev);
         return NULL;
     }
 
@@ -38,40 +100,128 @@ static void *spi_thread(void *arg)
     ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
     ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
 
-    #define BURST_SIZE 32  // Small bursts for low latency
-    uint8_t burst_buf[BURST_SIZE];
-    
-    while (1) {
-        int count = 0;
-        
-        // Collect real samples from ringbuffer
-        while (count < BURST_SIZE) {
-            uint8_t sample;
-            if (ringbuf_pop(rb, &sample)) {
-                burst_buf[count++] = sample;
-            } else {
-                // No more samples available
-                break;
-            }
+    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (tfd < 0) {
+        perror("timerfd");
+        return NULL;
+    }
+
+    int tick_us = sa->tick_us > 0 ? sa->tick_us : SPI_TICK_US_DEFAULT;
+    struct itimerspec its = {
+        .it_interval = { tick_us / 1000000, (tick_us % 1000000) * 1000L },
+        .it_value    = { tick_us / 1000000, (tick_us % 1000000) * 1000L },
+    };
+    struct itimerspec its_off = { 0 };
+
+    uint32_t watermark = sa->watermark > 0 ? sa->watermark : 1;
+    uint32_t prime = sa->prime > 0 ? sa->prime : 0;
+    int prime_ms = (int)(2000.0 * prime / sa->target_rate) + 1;   // 2x fill time
+    const double base_tick = sa->target_rate * tick_us / 1e6;   // bytes per tick
+    double per_tick = base_tick;
+    pico_view_t pv;
+    uint32_t sent = 0;          // ring stream position, for latency tags
+    uint8_t batch_buf[SPI_BATCH_MAX * SPI_BURST_MAX];
+    int lens[SPI_BATCH_MAX];
+
+    for (;;) {
+        // --- idle: sleep until the audio thread has queued enough ---
+        // An empty ring sleeps until the first byte arrives; after that
+        // the watermark wait is bounded by timeout_ms so a trickle of
+        // samples below the watermark still goes out.
+        bool empty = ringbuf_fill(rb) == 0;
+        int w = empty ? ringbuf_wait(rb, 1, SPI_IDLE_WAIT_MS)
+                      : ringbuf_wait(rb, watermark, sa->timeout_ms);
+        if (w != RINGBUF_READY) {
+            atomic_fetch_add_explicit(&st->wakeups, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&st->syscalls, 1, memory_order_relaxed);
         }
-        
-        // Send if we have any samples
-        if (count > 0) {
-            write(fd, burst_buf, count);
-//    struct timespec ts = { .tv_sec = 0, .tv_nsec = 5000 }; // 5 µs
-//    nanosleep(&ts, NULL);
-
-        } else {
-            // No data available - wait briefly
-            // This prevents spinning when ringbuf is empty
-            usleep(100);
+        if (empty || ringbuf_fill(rb) == 0)
+            continue;
+        if (w != RINGBUF_TIMEOUT && ringbuf_fill(rb) < watermark)
+            continue;
+
+        // --- prime: start at the drift setpoint so the loop starts settled ---
+        if (prime > watermark && ringbuf_fill(rb) < prime)
+            ringbuf_wait(rb, prime, prime_ms);
+
+        // --- paced: send target_rate bytes/s from the timer (trimmed by
+        // the Pico link when there is one) ---
+        timerfd_settime(tfd, 0, &its, NULL);
+        double credit = 0.0;
+        int empty_ticks = 0;
+
+        while (empty_ticks < SPI_IDLE_TICKS) {
+            uint64_t expirations;
+            if (read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+                continue;
+            atomic_fetch_add_explicit(&st->wakeups, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&st->syscalls, 1, memory_order_relaxed);
+
+            // the Pico link's trim: the rate STROBE actually drains at
+            if (sa->pico && pico_link_fetch(sa->pico, &pv))
+                per_tick = base_tick * (1.0 - pv.pace_ppm * 1e-6);
+
+            // cap carried credit so a stall doesn't turn into a burst
+            credit += per_tick * expirations;
+            if (credit > 2.0 * per_tick) credit = 2.0 * per_tick;
+
+            // never faster than the pacing rate: a backlog stays in the Pi
+            // ring (the drift loop works it off), where it can't lap the
+            // Pico's DMA ring
+            uint32_t fill = ringbuf_fill(rb);
+            uint32_t due = (uint32_t)credit;
+
+            int burst = pick_burst(fill);
+            atomic_store_explicit(&st->burst, burst, memory_order_relaxed);
+
+            if (due > (uint32_t)(SPI_BATCH_MAX * burst))
+                due = SPI_BATCH_MAX * burst;
+
+            uint32_t got = ringbuf_pop_bulk(rb, batch_buf, due);
+            if (got == 0) {
+                empty_ticks++;
+                continue;
+            }
+            empty_ticks = 0;
+            credit -= got;
+            if (credit < 0.0) credit = 0.0;
+
+            int n = 0;
+            for (uint32_t off = 0; off < got; off += burst)
+                lens[n++] = (got - off < (uint32_t)burst) ? (int)(got - off) : burst;
+
+            // spread the bursts across what the tick leaves after the
+            // wire time itself
+            int wire_us = (int)((uint64_t)got * 8 * 1000000 / SPI_SPEED);
+            int slack_us = tick_us - wire_us;
+            uint16_t delay_us = slack_us > 0 ? (uint16_t)(slack_us / n) : 0;
+
+            // counted, not printed: this runs 500 times a second under
+            // the UI
+            int calls = spi_send_batch(fd, batch_buf, lens, n, delay_us);
+            if (calls < 0) {
+                atomic_fetch_add_explicit(&st->errors, 1, memory_order_relaxed);
+                atomic_store_explicit(&st->error, errno, memory_order_relaxed);
+                calls = 0;
+            }
+            atomic_fetch_add_explicit(&st->syscalls, calls, memory_order_relaxed);
+            atomic_fetch_add_explicit(&st->bytes, got, memory_order_relaxed);
+
+            recorder_push_out(sa->rec, batch_buf, got);
+
+            sent += got;
+            if (sa->lat)
+                lat_tag_sent(sa->lat, sent, now_ns());
         }
+
+        // ring ran dry: stop the timer, go back to sleeping on the ring
+        timerfd_settime(tfd, 0, &its_off, NULL);
     }
 
     return NULL;
 }
 
-int spi_thread_create(pthread_t *th, spi_args_t *sa)
+int spi_thread_create(pthread_t *th, spi_args_t *sa, const rt_thread_cfg_t *rt)
 {
-    return pthread_create(th, NULL, spi_thread, sa);
+    return rt_thread_create(th, rt, "spi", spi_thread, sa);
 }
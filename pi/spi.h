@@ -2,13 +2,42 @@
 #define SPI_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include "ringbuf.h"
+#include "latency.h"
+#include "rt.h"
+#include "recorder.h"
+#include "pico_link.h"
+
+// Sender counters, written by the SPI thread, read by anyone
+typedef struct {
+    atomic_ulong wakeups;       // returns from a sleep (ring or pacing timer)
+    atomic_ulong syscalls;      // futex/timer waits + SPI transfers
+    atomic_ulong bytes;         // bytes sent to the Pico
+    atomic_uint  burst;         // current adaptive burst size
+    atomic_ulong errors;        // failed transfers
+    atomic_int   error;         // errno of the last failure, 0 = none yet
+} spi_stats_t;
 
 typedef struct {
     ringbuf_t *rb;
-    int target_rate;
+    const char *dev;            // spidev path, NULL = SPI_DEV_DEFAULT
+    float target_rate;          // Amiga sample rate the sender paces to
+    int watermark;              // start pacing at this ring fill
+    int prime;                  // ...but hold off until this fill (drift setpoint)
+    int timeout_ms;             // idle wait before re-checking the ring
+    int tick_us;                // pacing timer period
+    spi_stats_t *stats;
+    lat_trace_t *lat;           // latency tracing, NULL = off
+    recorder_t *rec;            // session recorder, NULL = off
+    const pico_link_t *pico;    // Pico ring feedback, NULL = Pi clock only
 } spi_args_t;
 
-int spi_thread_create(pthread_t *th, spi_args_t *sa);
+#define SPI_DEV_DEFAULT        "/dev/spidev0.0"
+#define SPI_WATERMARK_DEFAULT  32
+#define SPI_TIMEOUT_MS_DEFAULT 5
+#define SPI_TICK_US_DEFAULT    2000
+
+int spi_thread_create(pthread_t *th, spi_args_t *sa, const rt_thread_cfg_t *rt);
 
 #endif
@@ -13,7 +13,8 @@
 
 // globals from main.c
 extern ui_state_t ui;
-extern pthread_mutex_t cfg_lock;
+
+#define LATENCY_DUMP "latency.txt"
 
 static struct termios orig_term;
 static int tty_fd = -1;
@@ -56,15 +57,15 @@ void ui_shutdown(void) {
 // Initializer
 // -----------------------------------------------------------------------------
 void ui_init(ui_state_t *us) {
-    us->vu_level = 0;
-    us->peak_level = 0;
-    us->clipped = false;
-    us->clip_count = 0;
-    us->last_clip_time_ms = 0;
-    us->quant_noise = 0;
-    us->dc_offset = 0;
-    us->dsp_load = 0;
-    us->sampler_active = false;
+    for (int i = 0; i < us->n_inst; i++) {
+        ui_inst_t *ui_i = &us->inst[i];
+        memset(&ui_i->m, 0, sizeof(ui_i->m));
+        ui_i->spi_wakeups_ps = 0;
+        ui_i->spi_syscalls_ps = 0;
+        ui_i->spi_bytes_ps = 0;
+        ui_i->last_ms = 0;
+    }
+    us->sel = 0;
 
     term_raw_mode();
 
@@ -72,38 +73,6 @@ void ui_init(ui_state_t *us) {
     fflush(stdout);
 }
 
-// -----------------------------------------------------------------------------
-// Update metrics (called by audio thread)
-// -----------------------------------------------------------------------------
-void ui_update_audio_metrics(ui_state_t *us,
-                             float abs_sample,
-                             float quant_error,
-                             float dc,
-                             float load,
-                             uint64_t ts)
-{
-    us->vu_level = us->vu_level * 0.90f + abs_sample * 0.10f;
-
-    float decay = 0.995f;
-    if (us->peak_level * decay < abs_sample)
-        us->peak_level = abs_sample;
-    else
-        us->peak_level *= decay;
-
-    if (abs_sample >= 0.99f) {
-        us->clipped = true;
-        us->clip_count++;
-        us->last_clip_time_ms = ts;
-    } else {
-        if (us->clipped && (ts - us->last_clip_time_ms) > 1000)
-            us->clipped = false;
-    }
-
-    us->quant_noise = us->quant_noise * 0.99f + fabsf(quant_error) * 0.01f;
-    us->dc_offset   = us->dc_offset   * 0.999f + dc * 0.001f;
-    us->dsp_load    = us->dsp_load    * 0.90f  + load * 0.10f;
-}
-
 // -----------------------------------------------------------------------------
 // VU Bar Rendering
 // -----------------------------------------------------------------------------
@@ -137,18 +106,123 @@ static void pad_string(char *dst, const char *src, int width)
     snprintf(dst, 128, "%-*s", width, src);
 }
 
+// ALSA sizes and counters, "test signal" without a capture device
+static void format_capture(char *dst, size_t n, const capture_stats_t *cs) {
+    if (!cs) {
+        snprintf(dst, n, "test signal   ");
+        return;
+    }
+
+    int err = atomic_load_explicit(&cs->error, memory_order_relaxed);
+    if (err < 0) {
+        snprintf(dst, n, "\033[31m%s\033[0m   ", snd_strerror(err));
+        return;
+    }
+
+    unsigned period = atomic_load_explicit(&cs->period, memory_order_relaxed);
+    unsigned buffer = atomic_load_explicit(&cs->buffer, memory_order_relaxed);
+    unsigned long xruns = atomic_load_explicit(&cs->xruns, memory_order_relaxed);
+
+    snprintf(dst, n, "%s %u Hz %s %uch  period %u  buffer %u  xruns %s%lu\033[0m  "
+             "suspends %lu  recovered %lu   ",
+             atomic_load_explicit(&cs->mmap, memory_order_relaxed) ? "mmap" : "rw",
+             atomic_load_explicit(&cs->rate, memory_order_relaxed),
+             snd_pcm_format_name(atomic_load_explicit(&cs->format, memory_order_relaxed)),
+             atomic_load_explicit(&cs->channels, memory_order_relaxed),
+             period, buffer, xruns ? "\033[31m" : "", xruns,
+             atomic_load_explicit(&cs->suspends, memory_order_relaxed),
+             atomic_load_explicit(&cs->recoveries, memory_order_relaxed));
+}
+
+// Passes, size on disk vs raw, drops; "off" without --record-dir
+static void format_recorder(char *dst, size_t n, const recorder_t *r) {
+    if (!r) {
+        snprintf(dst, n, "off   ");
+        return;
+    }
+
+    int err = atomic_load_explicit(&r->error, memory_order_relaxed);
+    unsigned long raw = atomic_load_explicit(&r->raw_bytes, memory_order_relaxed);
+    unsigned long disk = atomic_load_explicit(&r->disk_bytes, memory_order_relaxed);
+    unsigned long dropped = atomic_load_explicit(&r->dropped, memory_order_relaxed);
+
+    snprintf(dst, n, "%s  passes %lu  %lu KB (%.0f%% of raw)  dropped %s%lu\033[0m%s%s   ",
+             atomic_load_explicit(&r->armed, memory_order_relaxed) ? "\033[31mREC\033[0m" : "idle",
+             atomic_load_explicit(&r->passes, memory_order_relaxed),
+             disk / 1024, raw ? 100.0 * disk / raw : 0.0,
+             dropped ? "\033[31m" : "", dropped,
+             err ? "  " : "", err ? strerror(err) : "");
+}
+
+// Pico ring and STROBE from its status line, and the pacing trim;
+// "off" without --pico-tty
+static void format_pico(char *dst, size_t n, const instance_t *in, const pico_view_t *v) {
+    if (!in->pico.tty) {
+        snprintf(dst, n, "off   ");
+        return;
+    }
+    if (!v->last_ms || now_ms() - v->last_ms > PICO_STALE_MS) {
+        snprintf(dst, n, "\033[31mno status\033[0m  pace %+7.1f ppm   ", v->pace_ppm);
+        return;
+    }
+
+    const pico_status_t *st = &v->st;
+    snprintf(dst, n, "%4u/%u bytes  STROBE %7.1f Hz  under %s%lu\033[0m  pace %+7.1f ppm%s   ",
+             st->fill, st->size, st->strobe_hz,
+             st->underruns ? "\033[31m" : "", st->underruns, v->pace_ppm,
+             st->active ? "" : "  (idle)");
+}
+
+static float level_db(float x) {
+    return (x > 1e-9f) ? 20.0f * log10f(x) : -90.0f;
+}
+
+// With more than one instance: a meter line each, '>' on the selected one
+static void format_instances(char *dst, size_t n, const ui_state_t *us) {
+    dst[0] = 0;
+    if (us->n_inst < 2)
+        return;
+
+    int len = snprintf(dst, n, "  %-10s %-16s %-18s %6s  %6s  %5s  %5s  %6s  %s\n",
+                       "Instance", "Preset", "Level", "VU", "Peak", "Load", "Ring",
+                       "Drift", "Amiga");
+    for (int i = 0; i < us->n_inst && len < (int)n; i++) {
+        const ui_inst_t *ui_i = &us->inst[i];
+        const audio_metrics_t *m = &ui_i->m;
+
+        char vu_str[256] = {0};
+        vu_bar(vu_str, 16, m->vu_level);
+
+        len += snprintf(dst + len, n - len,
+                        "%s %-10.10s %-16.16s [%s] %6.1f  %6.1f  %4.1f%%  %5.0f  %+6.1f  %s%s\n",
+                        i == us->sel ? ">" : " ",
+                        ui_i->in->name, preset_get(ui_i->in->preset)->name,
+                        vu_str, level_db(m->vu_level), level_db(m->peak_level),
+                        m->dsp_load * 100.0f, m->ring_fill, m->drift_ppm,
+                        ui_i->in->sampler_active ? "\033[32mACTIVE\033[0m" : "\033[90midle  \033[0m",
+                        m->clipped ? "  \033[31mCLIP\033[0m" : "      ");
+    }
+    if (len < (int)n)
+        snprintf(dst + len, n - len, "\n");
+}
+
 // -----------------------------------------------------------------------------
 // UI Draw
 // -----------------------------------------------------------------------------
 void ui_draw(const ui_state_t *us) {
     printf("\033[H");  // redraw from top, no flicker
 
-    float vu = us->vu_level;
-    float pk = us->peak_level;
-    float noise = us->quant_noise + 1e-12f;
-
-    float vu_db = (vu > 1e-9f) ? 20.0f * log10f(vu) : -90.0f;
-    float pk_db = (pk > 1e-9f) ? 20.0f * log10f(pk) : -90.0f;
+    // the detail view is the selected instance
+    const ui_inst_t *ui_i = &us->inst[us->sel];
+    const instance_t *in = ui_i->in;
+    const dsp_config_t *cfg = &in->cfg;
+    const audio_metrics_t *m = &ui_i->m;
+    float vu = m->vu_level;
+    float pk = m->peak_level;
+    float noise = m->quant_noise + 1e-12f;
+
+    float vu_db = level_db(vu);
+    float pk_db = level_db(pk);
     float noise_db = 20.0f * log10f(noise);
 
     char vu_str[512] = {0};
@@ -161,41 +235,109 @@ void ui_draw(const ui_state_t *us) {
     #define OFF "\033[31m■\033[0m"
 
     char preset_buf[128];
-    pad_string(preset_buf, us->preset_name, 24);
+    pad_string(preset_buf, preset_get(in->preset)->name, 24);
+
+    char inst_str[128] = {0};
+    if (us->n_inst > 1)
+        snprintf(inst_str, sizeof(inst_str), "Instance: \033[36m%-10s\033[0m (%d/%d)   ",
+                 in->name, us->sel + 1, us->n_inst);
+
+    // the oversampled section's share, while it runs; blanks otherwise
+    char os_str[64];
+    if (cfg->oversample > 1 && (cfg->compress || cfg->saturate) && !in->aa.fixed)
+        snprintf(os_str, sizeof(os_str), "  (%dx oversampling %4.1f%%)",
+                 cfg->oversample, m->os_load * 100.0f);
+    else
+        snprintf(os_str, sizeof(os_str), "%26s", "");
+
+    // failed transfers, with the last error, once there are any
+    char spi_err[64] = "";
+    unsigned long spi_errors = atomic_load_explicit(&in->spi_stats.errors, memory_order_relaxed);
+    if (spi_errors)
+        snprintf(spi_err, sizeof(spi_err), "  \033[31m%lu errors\033[0m (%s)", spi_errors,
+                 strerror(atomic_load_explicit(&in->spi_stats.error, memory_order_relaxed)));
+
+    char alsa_str[160];
+    format_capture(alsa_str, sizeof(alsa_str), instance_capture_stats(in));
+
+    char all_str[2048];
+    format_instances(all_str, sizeof(all_str), us);
+
+    char rec_str[160];
+    format_recorder(rec_str, sizeof(rec_str), us->rec);
+
+    char pico_str[160];
+    format_pico(pico_str, sizeof(pico_str), in, &ui_i->pico);
+
+    // one line per stage when tracing
+    char lat_str[512] = {0};
+    if (us->lat) {
+        int len = snprintf(lat_str, sizeof(lat_str), "Latency (ms):          p50      p99      max\n");
+        for (int s = 0; s < LAT_STAGES; s++) {
+            const lat_hist_t *h = &us->lat->stage[s];
+            len += snprintf(lat_str + len, sizeof(lat_str) - len,
+                            "  %-9s        %8.2f %8.2f %8.2f   \n",
+                            lat_stage_name(s),
+                            lat_percentile_us(h, 0.50) / 1000.0,
+                            lat_percentile_us(h, 0.99) / 1000.0,
+                            atomic_load_explicit(&h->max_us, memory_order_relaxed) / 1000.0);
+        }
+        snprintf(lat_str + len, sizeof(lat_str) - len, "\n");
+    }
 
     printf(
-"Preset:  \033[36m%s\033[0m    Sampler: %s\n\n"
+"%sPreset:  \033[36m%s\033[0m    Sampler: %s\n\n"
 
 "DSP Status:                               Levels:\n"
 "  Filter:     %s                 VU:   [%-30s]   %6.1f dBFS%20s\n"
 "  Shaper:     %s                 Peak: [%-30s]   %6.1f dBFS%20s\n"
-"  Dither:     %s                 Clip:  %s (%llu)\n"
+"  Dither:     %s %-6s          Clip:  %s (%llu)\n"
 "  Compressor: %s\n"
-"  Saturate:   %s\n\n"
+"  Saturate:   %s\n"
+"  Oversample: %dx  \n\n"
 
 "Stats:\n"
-"  DSP Load:            %4.1f%%\n"
+"  DSP Load:            %4.1f%%%s\n"
 "  Quantizer Noise:     %6.1f dBFS\n"
-"  DC Offset:           %+0.4f\n\n"
-
-"Keys: 1–8 presets  •  d s f c t x  •  q=quit\n",
-
+"  DC Offset:           %+0.4f\n"
+"  Ring / Drift:        %6.0f bytes  %+7.1f ppm   \n"
+"  SPI:                 %6.0f wakeups/s  %6.0f syscalls/s  %6.0f B/s  burst %3u%s   \n"
+"  Pico:                %s\n"
+"  ALSA:                %s\n"
+"  Record:              %s\n"
+"  RT:                  %s\n\n"
+"%s"
+"%s"
+"Keys: 1–8 presets  •  d s f c t o x  •  l=dump latency  •  %sq=quit\n",
+
+        inst_str,
         preset_buf,
-        us->sampler_active ? "\033[32mACTIVE\033[0m" : "\033[90midle  \033[0m",
+        in->sampler_active ? "\033[32mACTIVE\033[0m" : "\033[90midle  \033[0m",
 
-        us->cfg->filter ? ON : OFF,  vu_str, vu_db, "",
-        us->cfg->shape  ? ON : OFF,  pk_str, pk_db, "",
+        cfg->filter ? ON : OFF,  vu_str, vu_db, "",
+        cfg->shape  ? ON : OFF,  pk_str, pk_db, "",
 
-        us->cfg->dither ? ON : OFF,
-        us->clipped ? "\033[31mYES\033[0m" : "NO",
-        (unsigned long long)us->clip_count,
+        cfg->dither ? ON : OFF, dither_mode_name(cfg->dither_mode),
+        m->clipped ? "\033[31mYES\033[0m" : "NO",
+        (unsigned long long)m->clip_count,
 
-        us->cfg->compress ? ON : OFF,
-        us->cfg->saturate  ? ON : OFF,
+        cfg->compress ? ON : OFF,
+        cfg->saturate  ? ON : OFF,
+        cfg->oversample > 1 && !in->aa.fixed ? cfg->oversample : 1,
 
-        us->dsp_load * 100.0f,
+        m->dsp_load * 100.0f, os_str,
         noise_db,
-        us->dc_offset
+        m->dc_offset,
+        m->ring_fill, m->drift_ppm,
+        ui_i->spi_wakeups_ps, ui_i->spi_syscalls_ps, ui_i->spi_bytes_ps,
+        atomic_load_explicit(&in->spi_stats.burst, memory_order_relaxed), spi_err,
+        pico_str,
+        alsa_str,
+        rec_str,
+        us->rt_status ? us->rt_status : "",
+        all_str,
+        lat_str,
+        us->n_inst > 1 ? "Tab=next instance  •  " : ""
     );
 
     fflush(stdout);
@@ -204,12 +346,30 @@ void ui_draw(const ui_state_t *us) {
 // -----------------------------------------------------------------------------
 // Keyboard handling
 // -----------------------------------------------------------------------------
+// Only the UI thread writes an instance's cfg; every change is published
+// whole. Keys act on the selected instance.
+static instance_t *selected(void) {
+    return ui.inst[ui.sel].in;
+}
+
 static void apply_preset_index(int idx) {
-    pthread_mutex_lock(ui.cfg_lock);
-    preset_apply(idx, ui.cfg);
-    ui.preset_index = idx;
-    ui.preset_name = preset_get(idx)->name;
-    pthread_mutex_unlock(ui.cfg_lock);
+    instance_t *in = selected();
+    preset_apply(idx, &in->cfg);
+    in->preset = idx;
+    cfg_publish(&in->cfg_snap, &in->cfg);
+}
+
+// Append the full latency histograms to LATENCY_DUMP
+static void dump_latency(void) {
+    if (!ui.lat) return;
+
+    FILE *f = fopen(LATENCY_DUMP, "a");
+    if (!f) return;
+
+    time_t t = time(NULL);
+    fprintf(f, "# latency dump %s", ctime(&t));
+    lat_trace_dump(ui.lat, f);
+    fclose(f);
 }
 
 static void handle_key(int c) {
@@ -218,23 +378,58 @@ static void handle_key(int c) {
         return;
     }
 
-    pthread_mutex_lock(ui.cfg_lock);
+    dsp_config_t *cfg = &selected()->cfg;
+
     switch (c) {
-        case 'd': ui.cfg->dither   = !ui.cfg->dither;   break;
-        case 's': ui.cfg->shape    = !ui.cfg->shape;    break;
-        case 'f': ui.cfg->filter   = !ui.cfg->filter;   break;
-        case 'c': ui.cfg->compress = !ui.cfg->compress; break;
-        case 't': ui.cfg->saturate = !ui.cfg->saturate; break;
+        case 'd': cfg->dither   = !cfg->dither;   break;
+        case 's': cfg->shape    = !cfg->shape;    break;
+        case 'f': cfg->filter   = !cfg->filter;   break;
+        case 'c': cfg->compress = !cfg->compress; break;
+        case 't': cfg->saturate = !cfg->saturate; break;
+        case 'o': cfg->oversample = cfg->oversample >= 4 ? 1 : cfg->oversample >= 2 ? 4 : 2; break;
+        case '\t':
+            ui.sel = (ui.sel + 1) % ui.n_inst;
+            return;
         case 'x':
-            ui.peak_level = 0;
-            ui.clipped = false;
-            ui.clip_count = 0;
-            break;
+            // the audio thread owns the meters; ask it to clear them
+            metrics_request_reset(&selected()->metrics);
+            return;
+        case 'l':
+            dump_latency();
+            return;
         case 'q':
             ui_shutdown();
             exit(0);
+        default:
+            return;
     }
-    pthread_mutex_unlock(ui.cfg_lock);
+    cfg_publish(&selected()->cfg_snap, cfg);
+}
+
+// -----------------------------------------------------------------------------
+// SPI rates, recomputed about once a second from the sender's counters
+// -----------------------------------------------------------------------------
+static void update_spi_rates(ui_inst_t *ui_i) {
+    const spi_stats_t *st = &ui_i->in->spi_stats;
+
+    uint64_t t = now_ms();
+    if (t - ui_i->last_ms < 1000) return;
+
+    uint64_t wake  = atomic_load_explicit(&st->wakeups, memory_order_relaxed);
+    uint64_t sys   = atomic_load_explicit(&st->syscalls, memory_order_relaxed);
+    uint64_t bytes = atomic_load_explicit(&st->bytes, memory_order_relaxed);
+
+    if (ui_i->last_ms) {
+        float secs = (t - ui_i->last_ms) / 1000.0f;
+        ui_i->spi_wakeups_ps  = (wake  - ui_i->last_wake)  / secs;
+        ui_i->spi_syscalls_ps = (sys   - ui_i->last_sys)   / secs;
+        ui_i->spi_bytes_ps    = (bytes - ui_i->last_bytes) / secs;
+    }
+
+    ui_i->last_ms = t;
+    ui_i->last_wake = wake;
+    ui_i->last_sys = sys;
+    ui_i->last_bytes = bytes;
 }
 
 // -----------------------------------------------------------------------------
@@ -249,12 +444,18 @@ static void *ui_thread(void *arg) {
         if (tty_fd >= 0 && read(tty_fd, &ch, 1) == 1)
             handle_key(ch);
 
+        for (int i = 0; i < ui.n_inst; i++) {
+            metrics_fetch(&ui.inst[i].in->metrics, &ui.inst[i].m);
+            pico_link_fetch(&ui.inst[i].in->pico, &ui.inst[i].pico);
+            update_spi_rates(&ui.inst[i]);
+        }
+
         ui_draw(&ui);
     }
     return NULL;
 }
 
-int ui_thread_create(pthread_t *th, ui_state_t *us) {
+int ui_thread_create(pthread_t *th, ui_state_t *us, const rt_thread_cfg_t *rt) {
     (void)us;
-    return pthread_create(th, NULL, ui_thread, NULL);
+    return rt_thread_create(th, rt, "ui", ui_thread, NULL);
 }
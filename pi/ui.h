@@ -4,32 +4,47 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <pthread.h>
-#include "dsp.h"   // for dsp_config_t
+#include "instance.h"
+#include "latency.h"
+#include "rt.h"
+#include "recorder.h"
+
+// ------------------------------------------------------------
+// One instance as the UI sees it (UI thread only)
+// ------------------------------------------------------------
+typedef struct {
+    instance_t *in;             // config, snapshots and counters
+
+    // Audio meters: published by the audio thread, copied each redraw
+    audio_metrics_t m;          // last consistent copy
+
+    // Pico status and pacing trim, when there is a pico-tty
+    pico_view_t pico;
+
+    // SPI sender counters and their per-second rates
+    float spi_wakeups_ps;
+    float spi_syscalls_ps;
+    float spi_bytes_ps;
+    uint64_t last_ms, last_wake, last_sys, last_bytes;
+} ui_inst_t;
 
 // ------------------------------------------------------------
 // UI shared state structure
 // ------------------------------------------------------------
 typedef struct {
-    dsp_config_t *cfg;          // Points to global DSP config
-    pthread_mutex_t *cfg_lock;  // Protects cfg
-
-    // Dynamic audio metrics (written by audio thread)
-    float vu_level;             // Smoothed absolute level (0..1)
-    float peak_level;           // Slow decay peak (0..1)
-    bool clipped;               // Set when a clip is detected
-    uint64_t clip_count;        // Total clips
-    uint64_t last_clip_time_ms; // When last clip occurred (for clearing)
-
-    float quant_noise;          // Smoothed quantizer error magnitude
-    float dc_offset;            // Smoothed DC offset
-    float dsp_load;             // Realtime audio thread load %
-
-    const char *preset_name;    // UI-visible name
-    int preset_index;           // 0-based
+    ui_inst_t inst[INSTANCE_MAX];
+    int n_inst;
+    int sel;                    // instance the keys and detail view act on
+
     int preset_count;
 
-    // Sampler activity (set by GPIO monitor thread)
-    bool sampler_active;        // true when Pico asserts activity pin
+    // Per-stage latency histograms (NULL unless --latency-trace)
+    const lat_trace_t *lat;
+
+    // Session recorder counters (NULL unless --record-dir)
+    const recorder_t *rec;
+
+    const char *rt_status;      // what the RT setup could get, see rt.h
 
     // Internal timing for UI refresh
     uint64_t last_ui_update_ms;
@@ -40,25 +55,15 @@ typedef struct {
 // ------------------------------------------------------------
 
 // Called once at startup (main.c)
-//   cfg, cfg_lock, preset_count, preset_name initially set there
+//   inst[].in, n_inst, preset_count, lat, rec initially set there
 void ui_init(ui_state_t *us);
 
 // Start UI thread (non-blocking)
-int ui_thread_create(pthread_t *th, ui_state_t *us);
+int ui_thread_create(pthread_t *th, ui_state_t *us, const rt_thread_cfg_t *rt);
 
 // Terminal cleanup on exit (restores cooked mode)
 void ui_shutdown(void);
 
-// Utility the audio thread calls periodically to update stats
-void ui_update_audio_metrics(
-    ui_state_t *us,
-    float abs_sample,          // absolute sample value 0..1
-    float quant_error,         // oversampled quantizer error (shaped-quantized)
-    float dc,                  // raw dc-blocked sample
-    float load,                // dsp load 0..1
-    uint64_t now_ms            // timestamp
-);
-
 // UI thread draw function
 void ui_draw(const ui_state_t *us);
 